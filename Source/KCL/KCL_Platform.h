@@ -124,6 +124,41 @@
 #	error Not implemented for this compiler
 #endif
 
+// SIMD instruction sets enabled for the target
+#if defined(__AVX2__)
+#	define KCL_SIMD_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define KCL_SIMD_SSE2 1
+#endif
+
+// Index of the lowest set bit, undefined for 0
+#if defined(KCL_COMPILER_MSVC)
+#	include <intrin.h>
+#endif
+
+KCL_FORCEINLINE unsigned int KCL_CountTrailingZeros(unsigned int aValue)
+{
+#if defined(KCL_COMPILER_MSVC)
+	unsigned long index;
+	_BitScanForward(&index, aValue);
+	return index;
+#else
+	return __builtin_ctz(aValue);
+#endif
+}
+
+// Hints the processor to bring the cache line of the address in the cache, never faults
+#if defined(KCL_COMPILER_MSVC) && (defined(_M_X64) || defined(_M_IX86))
+#	include <xmmintrin.h>
+#	define KCL_PREFETCH(PTR) _mm_prefetch((const char*)(PTR), _MM_HINT_T0)
+#elif defined(KCL_COMPILER_MSVC)
+#	define KCL_PREFETCH(PTR) ((void)(PTR))
+#else
+#	define KCL_PREFETCH(PTR) __builtin_prefetch((const void*)(PTR))
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 // C++ Language Support
 //////////////////////////////////////////////////////////////////////////
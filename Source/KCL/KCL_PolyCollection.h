@@ -0,0 +1,235 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "KCL_RTTI.h"
+
+// Container of polymorphic objects, stored by value in one contiguous segment per dynamic type.
+// Iterating visits the segments one after the other: objects are read sequentially, and virtual calls made on the
+// objects of a segment all go to the same function so they are always predicted. Visiting the objects of a given type
+// casts each segment once instead of every object, and skips the segments that are not of this type.
+// Note:
+// * Inserted types must be registered with KCL_RTTI_REGISTER, the dynamic type of an object is its inserted type.
+// * Like std::vector, inserting in a segment invalidates the references to its objects.
+// * ForEach<T> with a final type T passes the exact type of the objects, the compiler devirtualizes calls on them.
+
+/*Usage :
+
+KCL::PolyCollection<Base> collection;
+collection.Emplace<Derived1>(args...);
+collection.Insert(Derived2());
+
+// Visits all objects as Base&, segment by segment
+collection.ForEach([](Base& anObject) { anObject.Update(); });
+
+// Visits only the objects that are a Derived1
+collection.ForEach<Derived1>([](Derived1& anObject) { anObject.Update(); });
+
+*/
+
+namespace KCL
+{
+template<typename Base>
+class PolyCollection
+{
+public:
+	PolyCollection() = default;
+	PolyCollection(PolyCollection&&) = default;
+	PolyCollection& operator=(PolyCollection&&) = default;
+
+	template<typename T, typename... Args>
+	T& Emplace(Args&&... someArgs)
+	{
+		static_assert(std::is_base_of<Base, T>::value, "Inserted types must derive from the collection base");
+		return GetOrCreateSegment<T>().Emplace(std::forward<Args>(someArgs)...);
+	}
+
+	template<typename T>
+	typename std::decay<T>::type& Insert(T&& anObject)
+	{
+		return Emplace<typename std::decay<T>::type>(std::forward<T>(anObject));
+	}
+
+	// Calls aFunctor(Base&) on all objects, segment by segment
+	template<typename Functor>
+	void ForEach(Functor&& aFunctor)
+	{
+		ForEachImpl<Base>(aFunctor);
+	}
+
+	template<typename Functor>
+	void ForEach(Functor&& aFunctor) const
+	{
+		ForEachImpl<const Base>(aFunctor);
+	}
+
+	// Calls aFunctor(Derived&) on the objects that are a Derived, other segments are skipped
+	template<typename Derived, typename Functor>
+	void ForEach(Functor&& aFunctor)
+	{
+		ForEachImpl<Derived>(aFunctor);
+	}
+
+	template<typename Derived, typename Functor>
+	void ForEach(Functor&& aFunctor) const
+	{
+		ForEachImpl<const Derived>(aFunctor);
+	}
+
+	size_t GetSize() const
+	{
+		size_t size = 0;
+		for (const std::unique_ptr<SegmentBase>& segment : mySegments)
+			size += segment->GetSize();
+		return size;
+	}
+
+	bool IsEmpty() const { return GetSize() == 0; }
+
+	// Number of objects of exactly the type T
+	template<typename T>
+	size_t GetSize() const
+	{
+		const SegmentBase* segment = FindSegment(KCL::RTTI::GetTypeId<T>());
+		return segment ? segment->GetSize() : 0;
+	}
+
+	// Destroys all objects, segments keep their memory
+	void Clear()
+	{
+		for (const std::unique_ptr<SegmentBase>& segment : mySegments)
+			segment->Clear();
+	}
+
+private:
+	// Type erased segment, iteration walks the storage with a stride instead of calling into the segment for each object
+	struct SegmentBase
+	{
+		SegmentBase(const KCL::RTTI::TypeInfo* aTypeInfo, size_t aStride, ptrdiff_t aBaseOffset)
+			: myTypeInfo(aTypeInfo)
+			, myStride(aStride)
+			, myBaseOffset(aBaseOffset)
+		{
+		}
+		virtual ~SegmentBase() {}
+
+		virtual char* GetData() const = 0;
+		virtual size_t GetSize() const = 0;
+		virtual void Clear() = 0;
+
+		const KCL::RTTI::TypeInfo* myTypeInfo;
+		size_t myStride;
+		ptrdiff_t myBaseOffset;
+	};
+
+	template<typename T>
+	struct Segment final : public SegmentBase
+	{
+		Segment()
+			: SegmentBase(KCL::RTTI::GetTypeInfo<T>(), sizeof(T), KCL::RTTI_Private::ComputePointerOffset<T, Base>())
+		{
+		}
+
+		template<typename... Args>
+		T& Emplace(Args&&... someArgs)
+		{
+			return myObjects.emplace_back(std::forward<Args>(someArgs)...);
+		}
+
+		char* GetData() const override { return (char*)myObjects.data(); }
+		size_t GetSize() const override { return myObjects.size(); }
+		void Clear() override { myObjects.clear(); }
+
+		std::vector<T> myObjects;
+	};
+
+	template<typename T>
+	Segment<T>& GetOrCreateSegment()
+	{
+		const KCL::RTTI::typeId_t typeId = KCL::RTTI::GetTypeId<T>();
+		if (SegmentBase* segment = FindSegment(typeId))
+			return static_cast<Segment<T>&>(*segment);
+
+		mySegments.emplace_back(new Segment<T>());
+		mySegmentTypeIds.push_back(typeId);
+		return static_cast<Segment<T>&>(*mySegments.back());
+	}
+
+	SegmentBase* FindSegment(KCL::RTTI::typeId_t aTypeId) const
+	{
+		for (size_t i = 0; i < mySegmentTypeIds.size(); ++i)
+			if (mySegmentTypeIds[i] == aTypeId)
+				return mySegments[i].get();
+		return nullptr;
+	}
+
+	template<typename T, typename Functor>
+	void ForEachImpl(Functor& aFunctor) const
+	{
+		static_assert(!std::is_pointer<T>::value && !std::is_reference<T>::value, "Pass the type to visit");
+
+		if constexpr (std::is_same<typename std::remove_cv<T>::type, Base>::value)
+		{
+			for (const std::unique_ptr<SegmentBase>& segment : mySegments)
+				VisitSegment<T>(*segment, segment->myBaseOffset, aFunctor);
+		}
+		else
+		{
+			const KCL::RTTI::typeId_t typeId = KCL::RTTI::GetTypeId<T>();
+			const KCL::RTTI::typeId_t depth = KCL::RTTI::GetTypeDepth<T>();
+			for (const std::unique_ptr<SegmentBase>& segment : mySegments)
+			{
+				if (segment->GetSize() == 0)
+					continue;
+
+				// The offset from the object to its T part is the same for the whole segment
+				const intptr_t object = (intptr_t)segment->GetData();
+				const intptr_t derived = segment->myTypeInfo->CastTo(object, typeId, depth);
+				if (derived != 0)
+					VisitSegment<T>(*segment, derived - object, aFunctor);
+			}
+		}
+	}
+
+	template<typename T, typename Functor>
+	static void VisitSegment(const SegmentBase& aSegment, ptrdiff_t anOffset, Functor& aFunctor)
+	{
+		const size_t size = aSegment.GetSize();
+		if (size == 0)
+			return;
+
+		char* object = aSegment.GetData() + anOffset;
+		char* end = object + size * aSegment.myStride;
+		for (; object != end; object += aSegment.myStride)
+			aFunctor(*reinterpret_cast<T*>(object));
+	}
+
+	std::vector<std::unique_ptr<SegmentBase>> mySegments;
+	// Searched when inserting, kept apart from the segments to be scanned contiguously
+	std::vector<KCL::RTTI::typeId_t> mySegmentTypeIds;
+};
+} // namespace KCL
@@ -22,21 +22,93 @@
 
 #pragma once
 
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
 
 #include "KCL_Platform.h"
 #include "KCL_Utils_Preprocessor.h"
 
+// Vectorized typeId scan, compares a whole SIMD register of ids at once. Enabled by default when the target supports it.
+#if !defined(KCL_RTTI_SIMD)
+#	if defined(KCL_SIMD_SSE2)
+#		define KCL_RTTI_SIMD 1
+#	else
+#		define KCL_RTTI_SIMD 0
+#	endif
+#endif
+
+// Eager registration creates the type info of every registered type during static initialization, before main.
+// Accessing the type info is then a plain address load instead of a function local static with a guard check.
+// Types must not be cast during static initialization in this mode, as their type info may not be created yet.
+#if !defined(KCL_RTTI_EAGER_REGISTRATION)
+#	define KCL_RTTI_EAGER_REGISTRATION 0
+#endif
+
+// Hashed type ids are a compile time hash of the name the type is registered with, instead of a runtime counter.
+// GetTypeId<T>() is then a constant expression, and ids are stable across runs and builds as long as names are unchanged.
+// Collisions stop the program when the TypeRegistry is built, and in debug builds when the types are registered.
+// The type data being built entirely from constant expressions, it is emitted in read only memory with no initialization code.
+#if !defined(KCL_RTTI_HASHED_TYPEID)
+#	define KCL_RTTI_HASHED_TYPEID 0
+#endif
+
+// Width in bits of the type ids, 8, 16 or 32. The sizes of the blocks of the type data are stored as ids as well.
+// Narrower ids make the type data smaller so that more of it stays in cache during casts, they limit the number of types
+// and the number of bases of a type. Hashed ids are folded to this width, making collisions more likely.
+#if !defined(KCL_RTTI_TYPEID_BITS)
+#	define KCL_RTTI_TYPEID_BITS 32
+#endif
+
+// Width in bits of the offsets to the secondary bases, 16, 32 or 64. Registered types with secondary bases must be
+// smaller than the largest offset, which is checked at compile time.
+#if !defined(KCL_RTTI_OFFSET_BITS)
+#	define KCL_RTTI_OFFSET_BITS 32
+#endif
+
+// Profiling records, per thread, the calls and the work of the casts walking the type data for each pair of dynamic type
+// and target type. See KCL_RTTI_Profile.h to report them. Casts are not instrumented at all when it is disabled.
+#if !defined(KCL_RTTI_PROFILE)
+#	define KCL_RTTI_PROFILE 0
+#endif
+
+// Number of type pairs recorded per thread when profiling, must be a power of two
+#if !defined(KCL_RTTI_PROFILE_CAPACITY)
+#	define KCL_RTTI_PROFILE_CAPACITY 16384
+#endif
+
+#if KCL_RTTI_HASHED_TYPEID
+#	define KCL_RTTI_TYPEID_CONSTEXPR constexpr
+#else
+#	define KCL_RTTI_TYPEID_CONSTEXPR
+#endif
+
+#if KCL_RTTI_SIMD
+#	if defined(KCL_SIMD_AVX2)
+#		include <immintrin.h>
+#	else
+#		include <emmintrin.h>
+#	endif
+#endif
+
 // Minimalistic and efficient RTTI Implementation.
 // Adds virtual methods to registered types, as polymorphism is necessary
 // Dynamic casts cost in the worst case one virtual call and walking through a data buffer
 
 // Note:
 // * This is not safe to pass across boundaries.
-// * This is not thread safe. The type info is created the first time it is accessed, race conditions may occur.
+// * Type registration is thread safe. By default the type info is created the first time it is accessed, guarded by a
+//   function local static, see KCL_RTTI_EAGER_REGISTRATION to create it before main instead.
+// * Offsets to secondary bases are computed before main, casting to a secondary base during static initialization is
+//   not supported.
 
 /*Usage :
 
@@ -60,8 +132,27 @@ namespace KCL
 // Details, this is not meant to be used outside of this file
 namespace RTTI_Private
 {
-// You can reduce the size at will here
+#if KCL_RTTI_TYPEID_BITS == 8
+typedef uint8_t typeId_t;
+#elif KCL_RTTI_TYPEID_BITS == 16
+typedef uint16_t typeId_t;
+#elif KCL_RTTI_TYPEID_BITS == 32
 typedef uint32_t typeId_t;
+#else
+#	error "KCL_RTTI_TYPEID_BITS must be 8, 16 or 32"
+#endif
+
+#if KCL_RTTI_OFFSET_BITS == 16
+typedef int16_t typeOffset_t;
+#elif KCL_RTTI_OFFSET_BITS == 32
+typedef int32_t typeOffset_t;
+#elif KCL_RTTI_OFFSET_BITS == 64
+typedef int64_t typeOffset_t;
+#else
+#	error "KCL_RTTI_OFFSET_BITS must be 16, 32 or 64"
+#endif
+
+static constexpr typeId_t theMaxTypeId = std::numeric_limits<typeId_t>::max();
 
 // Member ::Get() will return const TypeInfo*
 template<typename T>
@@ -69,48 +160,440 @@ struct GetTypeInfo
 {
 };
 
+// Detects if static_cast<To>(From) is well formed, downcasts from an ambiguous or virtual base are not
+template<typename From, typename To, typename = void>
+struct IsStaticCastable : std::false_type
+{
+};
+
+template<typename From, typename To>
+struct IsStaticCastable<From, To, std::void_t<decltype(static_cast<To>(std::declval<From>()))>> : std::true_type
+{
+};
+
+// Specialization will contain the magic data.
+template<typename T>
+struct TypeData;
+
+// Returns the index of aTypeId in the list of aSize ids starting at aIds, or aSize if not found
+KCL_FORCEINLINE typeId_t FindTypeIdScalar(const typeId_t* aIds, typeId_t aSize, typeId_t aTypeId)
+{
+	for (typeId_t i = 0; i < aSize; i++)
+	{
+		if (aIds[i] == aTypeId)
+			return i;
+	}
+	return aSize;
+}
+
+#if KCL_RTTI_SIMD
+
+#	if defined(KCL_SIMD_AVX2)
+typedef __m256i simdRegister_t;
+#	else
+typedef __m128i simdRegister_t;
+#	endif
+
+// Vector loads may read up to a register past the last id, TypeData is padded accordingly
+static constexpr size_t theTypeDataPadding = sizeof(simdRegister_t);
+
+KCL_FORCEINLINE simdRegister_t SplatTypeId(typeId_t aTypeId)
+{
+#	if defined(KCL_SIMD_AVX2)
+	if constexpr (sizeof(typeId_t) == 4)
+		return _mm256_set1_epi32((int)aTypeId);
+	else if constexpr (sizeof(typeId_t) == 2)
+		return _mm256_set1_epi16((short)aTypeId);
+	else
+		return _mm256_set1_epi8((char)aTypeId);
+#	else
+	if constexpr (sizeof(typeId_t) == 4)
+		return _mm_set1_epi32((int)aTypeId);
+	else if constexpr (sizeof(typeId_t) == 2)
+		return _mm_set1_epi16((short)aTypeId);
+	else
+		return _mm_set1_epi8((char)aTypeId);
+#	endif
+}
+
+// Returns one bit per byte of the register, set where the ids are equal
+KCL_FORCEINLINE uint32_t CompareTypeIds(const char* aIds, simdRegister_t aKey)
+{
+#	if defined(KCL_SIMD_AVX2)
+	const __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aIds));
+	if constexpr (sizeof(typeId_t) == 4)
+		return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(ids, aKey));
+	else if constexpr (sizeof(typeId_t) == 2)
+		return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(ids, aKey));
+	else
+		return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ids, aKey));
+#	else
+	const __m128i ids = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aIds));
+	if constexpr (sizeof(typeId_t) == 4)
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(ids, aKey));
+	else if constexpr (sizeof(typeId_t) == 2)
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(ids, aKey));
+	else
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ids, aKey));
+#	endif
+}
+
+// Same as FindTypeIdScalar, comparing sizeof(simdRegister_t) / sizeof(typeId_t) ids per instruction
+// Lanes loaded past the end of the list are masked out
+KCL_FORCEINLINE typeId_t FindTypeIdSIMD(const typeId_t* aIds, typeId_t aSize, typeId_t aTypeId)
+{
+	static_assert(sizeof(typeId_t) <= 4, "SIMD typeId scan supports ids up to 32 bits");
+
+	const simdRegister_t key = SplatTypeId(aTypeId);
+	const size_t byteSize = aSize * sizeof(typeId_t);
+
+	for (size_t byteIndex = 0; byteIndex < byteSize; byteIndex += sizeof(simdRegister_t))
+	{
+		uint32_t mask = CompareTypeIds(reinterpret_cast<const char*>(aIds) + byteIndex, key);
+
+		const size_t remaining = byteSize - byteIndex;
+		if (remaining < sizeof(simdRegister_t))
+			mask &= (1u << remaining) - 1;
+
+		if (mask != 0)
+			return (typeId_t)((byteIndex + KCL_CountTrailingZeros(mask)) / sizeof(typeId_t));
+	}
+	return aSize;
+}
+
+#else
+
+static constexpr size_t theTypeDataPadding = 0;
+
+KCL_FORCEINLINE typeId_t FindTypeIdSIMD(const typeId_t* aIds, typeId_t aSize, typeId_t aTypeId)
+{
+	return FindTypeIdScalar(aIds, aSize, aTypeId);
+}
+
+#endif
+
+#if KCL_RTTI_PROFILE
+
+static_assert((KCL_RTTI_PROFILE_CAPACITY & (KCL_RTTI_PROFILE_CAPACITY - 1)) == 0, "Profile capacity must be a power of two");
+static_assert(sizeof(typeId_t) <= sizeof(uint32_t), "Profile keys pack two type ids in 64 bits");
+
+// Depth passed when casting with the type id only, the head block is scanned
+static constexpr typeId_t theUnknownDepth = (typeId_t)-1;
+
+struct CastProfileEntry
+{
+	// Dynamic type id in the high 32 bits, target type id in the low 32 bits, 0 if the entry is empty
+	std::atomic<uint64_t> myKey;
+	std::atomic<uint64_t> myCallCount;
+	std::atomic<uint64_t> mySuccessCount;
+	std::atomic<uint64_t> myTypeIdCount;
+	std::atomic<uint64_t> myBlockCount;
+};
+
+// Casts recorded by a thread, in an open addressing table keyed by type pair.
+// Only the owning thread writes, counters are incremented with a relaxed load and store instead of an atomic add, and
+// other threads can read them at any time. Tables are never freed, the casts of threads which exited are still reported.
+struct CastProfileTable
+{
+	CastProfileEntry myEntries[KCL_RTTI_PROFILE_CAPACITY];
+	// Casts of pairs which did not fit in the table
+	std::atomic<uint64_t> myDroppedCount;
+	const CastProfileTable* myNext;
+};
+
+inline std::atomic<const CastProfileTable*>& GetCastProfileHead()
+{
+	static std::atomic<const CastProfileTable*> theHead(nullptr);
+	return theHead;
+}
+
+inline CastProfileTable* CreateCastProfileTable()
+{
+	CastProfileTable* table = new CastProfileTable();
+	std::atomic<const CastProfileTable*>& head = GetCastProfileHead();
+	table->myNext = head.load(std::memory_order_relaxed);
+	while (!head.compare_exchange_weak(table->myNext, table, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+	return table;
+}
+
+KCL_FORCEINLINE void AddToCounter(std::atomic<uint64_t>& aCounter, uint64_t aValue)
+{
+	aCounter.store(aCounter.load(std::memory_order_relaxed) + aValue, std::memory_order_relaxed);
+}
+
+// Replays the walk of TypeInfo::CastTo, counting the ids compared and the secondary blocks walked.
+// Ids are counted one by one even when the scan compares a whole SIMD register at once.
+inline void RecordCast(const typeId_t* aData, typeId_t aTypeId, typeId_t aDepth, bool anIsSuccess)
+{
+	const typeId_t headSize = aData[0];
+	const typeId_t* head = aData + 1;
+	uint64_t typeIdCount = 0;
+	uint64_t blockCount = 0;
+	bool isFound = false;
+
+	if (aDepth != theUnknownDepth)
+	{
+		typeIdCount = aDepth < headSize;
+		isFound = aDepth < headSize && head[headSize - 1 - aDepth] == aTypeId;
+	}
+	else
+	{
+		const typeId_t index = FindTypeIdScalar(head, headSize, aTypeId);
+		typeIdCount = index != headSize ? index + 1 : headSize;
+		isFound = index != headSize;
+	}
+
+	for (const typeId_t* block = head + headSize; !isFound && *block != 0; block += *block + 1)
+	{
+		const typeId_t index = FindTypeIdScalar(block + 1, *block, aTypeId);
+		typeIdCount += index != *block ? index + 1 : *block;
+		isFound = index != *block;
+		++blockCount;
+	}
+
+	static thread_local CastProfileTable* theTable = CreateCastProfileTable();
+	const uint64_t key = ((uint64_t)head[0] << 32) | (uint32_t)aTypeId;
+	const uint64_t mask = KCL_RTTI_PROFILE_CAPACITY - 1;
+	uint64_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32;
+	for (uint64_t probeCount = 0;; ++probeCount, ++slot)
+	{
+		if (probeCount == KCL_RTTI_PROFILE_CAPACITY)
+		{
+			AddToCounter(theTable->myDroppedCount, 1);
+			return;
+		}
+
+		CastProfileEntry& entry = theTable->myEntries[slot & mask];
+		const uint64_t entryKey = entry.myKey.load(std::memory_order_relaxed);
+		if (entryKey == 0)
+			entry.myKey.store(key, std::memory_order_release);
+		else if (entryKey != key)
+			continue;
+
+		AddToCounter(entry.myCallCount, 1);
+		AddToCounter(entry.mySuccessCount, anIsSuccess);
+		AddToCounter(entry.myTypeIdCount, typeIdCount);
+		AddToCounter(entry.myBlockCount, blockCount);
+		return;
+	}
+}
+
+#endif
+
 } // namespace RTTI_Private
 
 // Public RTTI API
 namespace RTTI
 {
 typedef KCL::RTTI_Private::typeId_t typeId_t;
+typedef KCL::RTTI_Private::typeOffset_t typeOffset_t;
 
-// Interface of TypeInfo
-struct TypeInfo
+// Strategy used to scan the type ids of a block, Scalar is always available for comparison
+enum class TypeIdScan
 {
-	KCL_FORCEINLINE const char* GetName() const { return myName; }
-	KCL_FORCEINLINE const char* GetTypeData() const { return (char*)(this + 1); }
-	KCL_FORCEINLINE typeId_t GetTypeId() const { return *(typeId_t*)(GetTypeData() + sizeof(typeId_t)); }
-	inline intptr_t CastTo(intptr_t aPtr, typeId_t aTypeId) const
+	Scalar,
+	SIMD // Falls back to Scalar if KCL_RTTI_SIMD is disabled
+};
+
+static constexpr TypeIdScan theDefaultTypeIdScan = KCL_RTTI_SIMD ? TypeIdScan::SIMD : TypeIdScan::Scalar;
+
+// FNV-1a hash of a type name, used as type id with KCL_RTTI_HASHED_TYPEID
+constexpr typeId_t HashTypeName(const char* aName)
+{
+	uint32_t hash = 2166136261u;
+	for (; *aName != 0; ++aName)
+		hash = (hash ^ (uint8_t)*aName) * 16777619u;
+
+	// Folds the hash to the width of the ids, 0 is never a valid type id
+	typeId_t typeId = 0;
+	for (size_t shift = 0; shift < 32; shift += sizeof(typeId_t) * 8)
+		typeId ^= (typeId_t)(hash >> shift);
+	return typeId != 0 ? typeId : 1;
+}
+
+struct TypeInfo;
+
+// How the value of a field is stored, deduced from its type
+enum class FieldKind : uint8_t
+{
+	Trivial, // Trivially copyable, the bytes are the value
+	Object, // Registered type, described by its own fields
+	Pointer, // Pointer to a registered polymorphic type
+	Unsupported
+};
+
+// Member of a type declared with KCL_RTTI_FIELDS, see KCL_RTTI_Fields.h
+struct FieldInfo
+{
+	// Type info of the field or of the type pointed to, nullptr if the type is not registered
+	KCL_FORCEINLINE const TypeInfo* GetTypeInfo() const { return myGetTypeInfo ? myGetTypeInfo() : nullptr; }
+
+	// Pointer fields only, returns the address of the most derived object pointed to and its type info, 0 if null
+	KCL_FORCEINLINE intptr_t GetPointee(intptr_t anObject, const TypeInfo*& aTypeInfoOut) const
 	{
-		const char* data = GetTypeData();
-		size_t byteIndex = 0;
-		ptrdiff_t offset = 0;
+		return myGetPointee(reinterpret_cast<const void*>(anObject + myOffset), aTypeInfoOut);
+	}
 
-		while (true)
-		{
-			typeId_t size = *reinterpret_cast<const typeId_t*>(data + byteIndex);
-			byteIndex += sizeof(typeId_t);
+	const char* myName;
+	// Offset from the most derived type
+	uint32_t myOffset;
+	uint32_t mySize;
+	const TypeInfo* (*myGetTypeInfo)();
+	intptr_t (*myGetPointee)(const void* aField, const TypeInfo*& aTypeInfoOut);
+	FieldKind myKind;
+};
+
+// Fields in offset order, adjacent trivial fields are merged in a single run so that they are copied at once
+struct FieldRun
+{
+	uint32_t myOffset;
+	uint32_t mySize;
+	// nullptr for a run of trivial fields
+	const FieldInfo* myField;
+};
 
-			for (typeId_t i = 0; i < size; i++, byteIndex += sizeof(typeId_t))
-			{
-				if (*reinterpret_cast<const typeId_t*>(data + byteIndex) == aTypeId)
-					return aPtr + offset;
-			}
+// Fields of a type in declaration order, empty if the type declares none
+struct FieldList
+{
+	KCL_FORCEINLINE const FieldRun* GetRunsBegin() const { return myRuns; }
+	KCL_FORCEINLINE const FieldRun* GetRunsEnd() const { return myRuns + myRunCount; }
 
-			offset = *reinterpret_cast<const ptrdiff_t*>(data + byteIndex);
-			if (offset == 0)
-				return 0;
+	KCL_FORCEINLINE const FieldInfo* begin() const { return myFields; }
+	KCL_FORCEINLINE const FieldInfo* end() const { return myFields + myCount; }
+	KCL_FORCEINLINE size_t GetCount() const { return myCount; }
 
-			byteIndex += sizeof(ptrdiff_t);
-		}
+	const FieldInfo* Find(const char* aName) const
+	{
+		for (const FieldInfo& field : *this)
+			if (strcmp(field.myName, aName) == 0)
+				return &field;
+		return nullptr;
+	}
+
+	const FieldInfo* myFields;
+	size_t myCount;
+	const FieldRun* myRuns;
+	size_t myRunCount;
+};
+
+// Size, alignment and lifetime of a registered type, to create objects from their type info, see KCL_RTTI_Factory.h
+struct ObjectTraits
+{
+	uint32_t mySize;
+	uint32_t myAlignment;
+	// Default constructs an object in aMemory and returns it, nullptr if the type is not default constructible
+	void* (*myConstruct)(void* aMemory);
+	// nullptr if the type is not destructible
+	void (*myDestruct)(void* anObject);
+	// Same with new and delete
+	void* (*myNew)();
+	void (*myDelete)(void* anObject);
+};
+
+// Interface of TypeInfo
+// The type data immediately follows the TypeInfo, see TypeDataImpl for its layout
+struct TypeInfo
+{
+	KCL_FORCEINLINE const char* GetName() const { return myName; }
+	KCL_FORCEINLINE const typeId_t* GetTypeData() const { return reinterpret_cast<const typeId_t*>(this + 1); }
+	KCL_FORCEINLINE typeId_t GetTypeId() const { return GetTypeData()[1]; }
+	// Depth of the type in its primary inheritance chain, 0 for a root type
+	KCL_FORCEINLINE typeId_t GetDepth() const { return GetTypeData()[0] - 1; }
+	KCL_FORCEINLINE const FieldList& GetFields() const { return *myFields; }
+	KCL_FORCEINLINE const ObjectTraits& GetObjectTraits() const { return myGetObjectTraits(); }
+
+	// Casts using the primary chain display first, then walks the secondary bases.
+	// The head block lists the primary chain (offset 0) from the most derived type to the root, so the ancestor at depth D
+	// is at index (depth - D). Testing it is a single compare regardless of how deep the hierarchy is.
+	template<TypeIdScan Scan = theDefaultTypeIdScan>
+	KCL_FORCEINLINE intptr_t CastTo(intptr_t aPtr, typeId_t aTypeId, typeId_t aDepth) const
+	{
+#if KCL_RTTI_PROFILE
+		const intptr_t result = CastToImpl<Scan>(aPtr, aTypeId, aDepth);
+		KCL::RTTI_Private::RecordCast(GetTypeData(), aTypeId, aDepth, result != 0);
+		return result;
+#else
+		return CastToImpl<Scan>(aPtr, aTypeId, aDepth);
+#endif
+	}
+
+	// Slower version for when only the type id is known, walks all the blocks
+	template<TypeIdScan Scan = theDefaultTypeIdScan>
+	KCL_FORCEINLINE intptr_t CastTo(intptr_t aPtr, typeId_t aTypeId) const
+	{
+#if KCL_RTTI_PROFILE
+		const intptr_t result = CastToImpl<Scan>(aPtr, aTypeId);
+		KCL::RTTI_Private::RecordCast(GetTypeData(), aTypeId, KCL::RTTI_Private::theUnknownDepth, result != 0);
+		return result;
+#else
+		return CastToImpl<Scan>(aPtr, aTypeId);
+#endif
 	}
 
 	KCL_FORCEINLINE bool operator==(const TypeInfo& anOther) const { return GetTypeId() == anOther.GetTypeId(); }
 	KCL_FORCEINLINE bool operator!=(const TypeInfo& anOther) const { return GetTypeId() != anOther.GetTypeId(); }
 
 	const char* myName;
+	// Offsets of the secondary blocks from the most derived type, in block order
+	const typeOffset_t* myOffsets;
+	// Set before main by KCL_RTTI_FIELDS, which may come after the registration of the type
+	const FieldList* myFields;
+	// An accessor, the type may be incomplete where it is registered
+	const ObjectTraits& (*myGetObjectTraits)();
+
+private:
+	template<TypeIdScan Scan>
+	inline intptr_t CastToImpl(intptr_t aPtr, typeId_t aTypeId, typeId_t aDepth) const
+	{
+		const typeId_t* data = GetTypeData();
+		const typeId_t headSize = data[0];
+		const typeId_t* head = data + 1;
+
+		if (aDepth < headSize && head[headSize - 1 - aDepth] == aTypeId)
+			return aPtr;
+
+		return CastToSecondaryBases<Scan>(aPtr, aTypeId, head + headSize);
+	}
+
+	template<TypeIdScan Scan>
+	inline intptr_t CastToImpl(intptr_t aPtr, typeId_t aTypeId) const
+	{
+		const typeId_t* data = GetTypeData();
+		const typeId_t headSize = data[0];
+
+		if (FindTypeId<Scan>(data + 1, headSize, aTypeId) != headSize)
+			return aPtr;
+
+		return CastToSecondaryBases<Scan>(aPtr, aTypeId, data + 1 + headSize);
+	}
+
+	template<TypeIdScan Scan>
+	KCL_FORCEINLINE static typeId_t FindTypeId(const typeId_t* aIds, typeId_t aSize, typeId_t aTypeId)
+	{
+		if constexpr (Scan == TypeIdScan::SIMD)
+			return KCL::RTTI_Private::FindTypeIdSIMD(aIds, aSize, aTypeId);
+		else
+			return KCL::RTTI_Private::FindTypeIdScalar(aIds, aSize, aTypeId);
+	}
+
+	// Walks the blocks following the head block, aBlocks points to the size of the first secondary block
+	template<TypeIdScan Scan>
+	inline intptr_t CastToSecondaryBases(intptr_t aPtr, typeId_t aTypeId, const typeId_t* aBlocks) const
+	{
+		const typeOffset_t* offset = myOffsets;
+
+		for (typeId_t size = *aBlocks; size != 0; size = *aBlocks, ++offset)
+		{
+			if (FindTypeId<Scan>(aBlocks + 1, size, aTypeId) != size)
+				return aPtr + *offset;
+
+			aBlocks += size + 1;
+		}
+
+		return 0;
+	}
 };
 
 // Public interface to access type information
@@ -123,9 +606,52 @@ KCL_FORCEINLINE const TypeInfo* GetTypeInfo()
 }
 
 template<typename T>
-KCL_FORCEINLINE typeId_t GetTypeId()
+KCL_FORCEINLINE KCL_RTTI_TYPEID_CONSTEXPR typeId_t GetTypeId()
 {
+#if KCL_RTTI_HASHED_TYPEID
+	typedef typename std::decay<typename std::remove_cv<T>::type>::type Type;
+	return KCL::RTTI_Private::GetTypeInfo<Type>::ourTypeId;
+#else
 	return GetTypeInfo<T>()->GetTypeId();
+#endif
+}
+
+// Depth of the type in its primary inheritance chain, known at compile time
+template<typename T>
+constexpr typeId_t GetTypeDepth()
+{
+	typedef typename std::decay<typename std::remove_cv<T>::type>::type Type;
+	return KCL::RTTI_Private::TypeData<Type>::ourDepth;
+}
+
+// True if the dynamic type of the object is exactly T, a single compare without walking the type data
+template<typename T, typename Base>
+KCL_FORCEINLINE bool IsExactly(const Base* aBasePtr)
+{
+	return aBasePtr && aBasePtr->KCL_RTTI_GetTypeId() == GetTypeId<T>();
+}
+
+// Casts only if the dynamic type of the object is exactly the type pointed by Derived
+template<typename Derived, typename Base>
+KCL_FORCEINLINE Derived ExactCast(Base* aBasePtr)
+{
+	static_assert(std::is_pointer<Derived>::value, "Return type must be a pointer");
+	typedef typename std::remove_pointer<Derived>::type DerivedObjectType;
+
+	// An object of type Derived can only be pointed by one of its bases
+	if constexpr (!std::is_base_of<Base, DerivedObjectType>::value)
+		return nullptr;
+	else
+	{
+		if (!IsExactly<DerivedObjectType>(aBasePtr))
+			return nullptr;
+
+		if constexpr (KCL::RTTI_Private::IsStaticCastable<Base*, Derived>::value)
+			return static_cast<Derived>(aBasePtr);
+		else // Ambiguous or virtual base, the offset is only known from the type data
+			return reinterpret_cast<Derived>(
+				aBasePtr->KCL_RTTI_DynamicCast(GetTypeId<DerivedObjectType>(), GetTypeDepth<DerivedObjectType>()));
+	}
 }
 
 template<typename Derived, typename Base>
@@ -136,149 +662,327 @@ KCL_FORCEINLINE Derived DynamicCast(Base* aBasePtr)
 
 	if constexpr (std::is_base_of<DerivedObjectType, Base>::value)
 		return static_cast<Derived>(aBasePtr);
+	else if constexpr (std::is_final<DerivedObjectType>::value) // Nothing derives from a final type, only an exact match can succeed
+		return ExactCast<Derived>(aBasePtr);
 	else if (aBasePtr)
-		return reinterpret_cast<Derived>(aBasePtr->KCL_RTTI_DynamicCast(GetTypeId<DerivedObjectType>()));
+		return reinterpret_cast<Derived>(
+			aBasePtr->KCL_RTTI_DynamicCast(GetTypeId<DerivedObjectType>(), GetTypeDepth<DerivedObjectType>()));
 	else
 		return nullptr;
 }
 
+// Address of the most derived object, like dynamic_cast<void*>, and its type info. 0 for a null pointer
+template<typename T>
+KCL_FORCEINLINE intptr_t GetMostDerived(const T* anObject, const TypeInfo*& aTypeInfoOut)
+{
+	if (!anObject)
+		return 0;
+
+	// T may be present several times in the dynamic type, only the object knows which subobject it is
+	aTypeInfoOut = anObject->KCL_RTTI_GetTypeInfo();
+	return anObject->KCL_RTTI_DynamicCast(aTypeInfoOut->GetTypeId(), aTypeInfoOut->GetDepth());
+}
+
 } // namespace RTTI
 
 namespace RTTI_Private
 {
-static typeId_t GenerateId()
+// Any non null address works to compute offsets from the type data, no object is accessed
+static constexpr intptr_t theProbePtr = 0x10000;
+static constexpr intptr_t theNotABaseOffset = std::numeric_limits<intptr_t>::min();
+// Markers of the offsets that caches and tables store on 32 bits, offsets between a base and a derived type are much smaller
+static constexpr int32_t theFailedCastOffset = std::numeric_limits<int32_t>::min();
+static constexpr int32_t theAmbiguousOffset = theFailedCastOffset + 1;
+
+// Offset of the first base of the given type in an object of the type, theNotABaseOffset if the type does not derive from it
+KCL_FORCEINLINE intptr_t GetBaseOffset(const RTTI::TypeInfo* aTypeInfo, RTTI::typeId_t aBaseTypeId, RTTI::typeId_t aBaseDepth)
 {
-	// magic number that increases every time it is called
-	static typeId_t theTypeIdCounter = 0;
-	return ++theTypeIdCounter;
+	const intptr_t result = aTypeInfo->CastTo(theProbePtr, aBaseTypeId, aBaseDepth);
+	return result != 0 ? result - theProbePtr : theNotABaseOffset;
 }
 
-template<typename Derived, typename Base>
-static ptrdiff_t ComputePointerOffset()
+// Slower version for when only the type id is known
+KCL_FORCEINLINE intptr_t GetBaseOffset(const RTTI::TypeInfo* aTypeInfo, RTTI::typeId_t aBaseTypeId)
 {
-	Derived* derivedPtr = (Derived*)1;
-	Base* basePtr = static_cast<Base*>(derivedPtr);
-	return (intptr_t)basePtr - (intptr_t)derivedPtr;
+	const intptr_t result = aTypeInfo->CastTo(theProbePtr, aBaseTypeId);
+	return result != 0 ? result - theProbePtr : theNotABaseOffset;
 }
 
-#pragma pack(push, 1)
-
-// Specialization will contain the magic data.
+// Fields of a type, empty until set by KCL_RTTI_FIELDS during static initialization
 template<typename T>
-struct TypeData
+struct TypeFields
 {
+	static inline RTTI::FieldList ourFields = {nullptr, 0, nullptr, 0};
 };
 
-// Recursively populates the typeData
-// Layout of typeData:
-// [ typeId_t size, typeId_t firstTypeId ... typeId_t lastTypeId, ptrdiff_t offset/endMarker if = 0,
-// typeId_t size, typeId_t firstTypeId ... typeId_t lastTypeId, ptrdiff_t offset/endMarker if = 0... ]
-// Each block represents inherited types from a base, the first block doesn't need offset as it is implicitly 0
-// Therefore we can use the offset as an end marker, all other bases will have a positive offset
-template<typename... BaseTypes>
-struct BaseTypeData
+template<typename T>
+void* ConstructObject(void* aMemory)
 {
-};
+	return new (aMemory) T();
+}
+
+template<typename T>
+void DestructObject(void* anObject)
+{
+	static_cast<T*>(anObject)->~T();
+}
+
+template<typename T>
+void* NewObject()
+{
+	return new T();
+}
+
+// The object is exactly a T, the destructor does not need to be virtual
+template<typename T>
+void DeleteObject(void* anObject)
+{
+	std::default_delete<T>()(static_cast<T*>(anObject));
+}
+
+// Instantiated at the end of the translation unit, the type only needs to be complete there
+template<typename T>
+const RTTI::ObjectTraits& GetObjectTraits()
+{
+	constexpr bool isConstructible = std::is_default_constructible<T>::value && !std::is_abstract<T>::value;
+	constexpr bool isDestructible = std::is_destructible<T>::value;
+	// int stands in for the types that cannot be constructed or destroyed, so that their functions are not instantiated
+	static const RTTI::ObjectTraits theTraits = {
+		(uint32_t)sizeof(T),
+		(uint32_t)alignof(T),
+		isConstructible ? &ConstructObject<std::conditional_t<isConstructible, T, int>> : nullptr,
+		isDestructible ? &DestructObject<std::conditional_t<isDestructible, T, int>> : nullptr,
+		isConstructible ? &NewObject<std::conditional_t<isConstructible, T, int>> : nullptr,
+		isDestructible ? &DeleteObject<std::conditional_t<isDestructible, T, int>> : nullptr};
+	return theTraits;
+}
+
+// Registration errors would make casts return wrong results, they stop the program in every build
+[[noreturn]] KCL_NOINLINE inline void RegistrationError(const char* aMessage)
+{
+	fprintf(stderr, "KCL RTTI: %s\n", aMessage);
+	std::abort();
+}
+
+inline typeId_t GenerateId()
+{
+	// magic number that increases every time it is called, types may be registered concurrently from several threads
+	static std::atomic<uint32_t> theTypeIdCounter(0);
+	const uint32_t typeId = theTypeIdCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (typeId > theMaxTypeId)
+		RegistrationError("More types are registered than KCL_RTTI_TYPEID_BITS can identify");
+	return (typeId_t)typeId;
+}
 
-template <typename Type>
-struct BaseTypeData<std::enable_shared_from_this<Type>> {
-  template <typename Derived>
-  void FillBaseTypeData(std::ptrdiff_t, typeId_t&) {}
+// All registered types are linked in a lock free list before main, registration happens from several translation units.
+// The list holds accessors as the type info is created depending on the registration mode.
+typedef const RTTI::TypeInfo* (*GetTypeInfoFunc)();
+
+struct TypeRegistration
+{
+	explicit TypeRegistration(GetTypeInfoFunc aGetTypeInfo);
+
+	GetTypeInfoFunc myGetTypeInfo;
+	const TypeRegistration* myNext;
 };
 
-template<typename FirstBase, typename SecondBase, typename... Next>
-struct BaseTypeData<FirstBase, SecondBase, Next...>
+inline std::atomic<const TypeRegistration*>& GetTypeRegistrationHead()
+{
+	static std::atomic<const TypeRegistration*> theHead(nullptr);
+	return theHead;
+}
+
+inline TypeRegistration::TypeRegistration(GetTypeInfoFunc aGetTypeInfo)
+	: myGetTypeInfo(aGetTypeInfo)
+	, myNext(nullptr)
 {
-	template<typename Derived>
-	void FillBaseTypeData(ptrdiff_t aOffset, typeId_t& outHeadSize)
+	std::atomic<const TypeRegistration*>& head = GetTypeRegistrationHead();
+
+#if KCL_RTTI_HASHED_TYPEID && !defined(NDEBUG)
+	// Quadratic in the number of types, release builds only check once the registry is built and the ids are sorted.
+	// Hashed type infos are constants, accessing them does not create anything
+	const typeId_t typeId = aGetTypeInfo()->GetTypeId();
+	for (const TypeRegistration* it = head.load(std::memory_order_acquire); it != nullptr; it = it->myNext)
 	{
-		myFirst.template FillBaseTypeData<Derived>(ComputePointerOffset<Derived, FirstBase>(), outHeadSize);
+		if (it->myGetTypeInfo()->GetTypeId() == typeId)
+		{
+			fprintf(stderr, "KCL RTTI: %s and %s have the same hashed id\n", it->myGetTypeInfo()->GetName(), aGetTypeInfo()->GetName());
+			RegistrationError("Type id collision, rename one of the types");
+		}
+	}
+#endif
 
-		myOffset = ComputePointerOffset<Derived, SecondBase>();
-		myNext.template FillBaseTypeData<Derived>(myOffset, mySize);
+	myNext = head.load(std::memory_order_relaxed);
+	while (!head.compare_exchange_weak(myNext, this, std::memory_order_release, std::memory_order_relaxed))
+	{
 	}
+}
 
-	BaseTypeData<FirstBase> myFirst;
-	ptrdiff_t myOffset;
-	typeId_t mySize;
-	BaseTypeData<SecondBase, Next...> myNext;
+template<typename Derived, typename Base>
+static ptrdiff_t ComputePointerOffset()
+{
+	Derived* derivedPtr = (Derived*)1;
+	Base* basePtr = static_cast<Base*>(derivedPtr);
+	return (intptr_t)basePtr - (intptr_t)derivedPtr;
+}
+
+// Vector loads may read past the end marker, the padding is part of the type data
+static_assert(theTypeDataPadding % sizeof(typeId_t) == 0, "Padding must be a whole number of ids");
+static constexpr size_t theTypeDataPaddingSize = theTypeDataPadding / sizeof(typeId_t);
+
+// Offsets of the secondary blocks of a type
+// They are the only part of the type data that cannot be computed at compile time, they are computed before main
+template<size_t Count>
+struct TypeOffsets
+{
+	typeOffset_t myOffsets[Count > 0 ? Count : 1];
 };
 
+// Describes what a base contributes to the type data of a derived type
 template<typename Base>
-struct BaseTypeData<Base>
+struct BaseLayout
 {
-	template<typename Derived>
-	void FillBaseTypeData(ptrdiff_t aOffset, typeId_t& outHeadSize)
-	{
-		const TypeData<Base>* baseTypeId = (TypeData<Base>*)(GetTypeInfo<Base>::Get()->GetTypeData());
-
-		// return size of head list
-		outHeadSize = baseTypeId->mySize;
+	// The first base's data is appended to the head block, without its head size and end marker
+	static constexpr typeId_t ourHeadSize = TypeData<Base>::ourDepth + 1;
+	static constexpr size_t ourHeadDataSize = TypeData<Base>::ourDataSize - 2;
+	static constexpr size_t ourHeadOffsetCount = TypeData<Base>::ourOffsetCount;
 
-		const char* data = baseTypeId->GetData();
-		size_t byteSize = baseTypeId->mySize * sizeof(typeId_t);
+	// Other bases' data is appended as secondary blocks, without end marker
+	static constexpr size_t ourBlockDataSize = TypeData<Base>::ourDataSize - 1;
+	static constexpr size_t ourBlockOffsetCount = TypeData<Base>::ourOffsetCount + 1;
 
-		// copy type list
-		memcpy(myData, data, byteSize);
+	static KCL_RTTI_TYPEID_CONSTEXPR const typeId_t* GetTypeData()
+	{
+#if KCL_RTTI_HASHED_TYPEID
+		return GetTypeInfo<Base>::ourInstance.myData.myBuffer;
+#else
+		const typeId_t* data = GetTypeInfo<Base>::Get()->GetTypeData();
+		assert(data[0] != 0 && "Base type info is not created yet, registration order issue");
+		return data;
+#endif
+	}
 
-		size_t byteIndex = byteSize;
-		ptrdiff_t offset = *reinterpret_cast<const ptrdiff_t*>(data + byteIndex);
-		while (offset != 0)
-		{
-			// fill next offset and add pointer offset
-			*reinterpret_cast<ptrdiff_t*>(myData + byteIndex) = offset + aOffset;
-			byteIndex += sizeof(ptrdiff_t);
+	static KCL_RTTI_TYPEID_CONSTEXPR size_t CopyAsHead(typeId_t* anOutData, size_t anIndex)
+	{
+		const typeId_t* data = GetTypeData();
+		for (size_t i = 1; i <= ourHeadDataSize; i++)
+			anOutData[anIndex++] = data[i];
+		return anIndex;
+	}
 
-			// fill next size
-			const typeId_t size = *reinterpret_cast<const typeId_t*>(data + byteIndex);
-			*reinterpret_cast<typeId_t*>(myData + byteIndex) = size;
-			byteSize = size * sizeof(typeId_t);
-			byteIndex += sizeof(typeId_t);
+	static KCL_RTTI_TYPEID_CONSTEXPR size_t CopyAsBlocks(typeId_t* anOutData, size_t anIndex)
+	{
+		const typeId_t* data = GetTypeData();
+		for (size_t i = 0; i < ourBlockDataSize; i++)
+			anOutData[anIndex++] = data[i];
+		return anIndex;
+	}
 
-			// copy types
-			memcpy(myData + byteIndex, data + byteIndex, byteSize);
-			byteIndex += byteSize;
+	static void FillHeadOffsets(ptrdiff_t anOffset, typeOffset_t*& anOutOffsets) { TypeData<Base>::FillOffsets(anOffset, anOutOffsets); }
 
-			offset = *reinterpret_cast<const ptrdiff_t*>(data + byteIndex);
-		}
+	static void FillBlockOffsets(ptrdiff_t anOffset, typeOffset_t*& anOutOffsets)
+	{
+		*anOutOffsets++ = (typeOffset_t)anOffset;
+		TypeData<Base>::FillOffsets(anOffset, anOutOffsets);
 	}
+};
 
-	// We only need the previous type data array, but not its size or end marker
-	char myData[sizeof(TypeData<Base>) - sizeof(ptrdiff_t) - sizeof(typeId_t)];
+// Bases which are not registered contribute nothing
+template<typename Type>
+struct BaseLayout<std::enable_shared_from_this<Type>>
+{
+	static constexpr typeId_t ourHeadSize = 0;
+	static constexpr size_t ourHeadDataSize = 0;
+	static constexpr size_t ourHeadOffsetCount = 0;
+	static constexpr size_t ourBlockDataSize = 0;
+	static constexpr size_t ourBlockOffsetCount = 0;
+
+	static constexpr size_t CopyAsHead(typeId_t*, size_t anIndex) { return anIndex; }
+	static constexpr size_t CopyAsBlocks(typeId_t*, size_t anIndex) { return anIndex; }
+	static void FillHeadOffsets(ptrdiff_t, typeOffset_t*&) {}
+	static void FillBlockOffsets(ptrdiff_t, typeOffset_t*&) {}
 };
 
-// Actual implementation of TypeData<Type>
+// Actual implementation of TypeData<Type>, built from the type data of its bases
+// Layout of the data:
+// [ typeId_t headSize, typeId_t typeId, typeId_t firstBaseTypeId ... typeId_t rootTypeId,
+//   typeId_t size, typeId_t firstTypeId ... typeId_t lastTypeId,
+//   typeId_t size, typeId_t firstTypeId ... typeId_t lastTypeId, ... typeId_t endMarker = 0, padding ]
+// Each block represents inherited types from a base. The head block is the primary chain, which is at offset 0.
+// The other blocks' offsets are stored separately, see TypeOffsets, so the data can be a constant expression.
+// With KCL_RTTI_HASHED_TYPEID the type data is built at compile time and placed in read only memory.
 template<typename Type, typename... BaseTypes>
-struct TypeDataImpl
+struct TypeDataImpl;
+
+template<typename Type, typename FirstBase, typename... NextBases>
+struct TypeDataImpl<Type, FirstBase, NextBases...>
 {
-	TypeDataImpl()
+	static constexpr typeId_t ourDepth = BaseLayout<FirstBase>::ourHeadSize;
+	static constexpr size_t ourDataSize = 3 + BaseLayout<FirstBase>::ourHeadDataSize + (BaseLayout<NextBases>::ourBlockDataSize + ... + 0);
+	static constexpr size_t ourOffsetCount =
+		BaseLayout<FirstBase>::ourHeadOffsetCount + (BaseLayout<NextBases>::ourBlockOffsetCount + ... + 0);
+
+	// Block sizes and depths are stored as ids, and are at most the size of the data
+	static_assert(ourDataSize <= theMaxTypeId, "Too many bases for KCL_RTTI_TYPEID_BITS");
+
+	KCL_RTTI_TYPEID_CONSTEXPR explicit TypeDataImpl(typeId_t aTypeId)
+		: myBuffer{}
 	{
-		myTypeId = GenerateId();
-		myBaseTypeData.template FillBaseTypeData<Type>(0 /* No offset with first base */, mySize);
-		mySize++; // Size is the base's size + 1 to account for current type id
-		myEndMarker = 0;
+		size_t index = 0;
+		myBuffer[index++] = ourDepth + 1; // Size is the base's size + 1 to account for current type id
+		myBuffer[index++] = aTypeId;
+		index = BaseLayout<FirstBase>::CopyAsHead(myBuffer, index);
+		((index = BaseLayout<NextBases>::CopyAsBlocks(myBuffer, index)), ...);
+		myBuffer[index] = 0; // End marker
 	}
 
-	const char* GetData() const { return (char*)&myTypeId; }
+	// Writes the offsets of the secondary blocks, anOffset being the offset of Type in the most derived type
+	static void FillOffsets(ptrdiff_t anOffset, typeOffset_t*& anOutOffsets)
+	{
+		assert((ComputePointerOffset<Type, FirstBase>() == 0) && "The first base must be at offset 0 as it is the primary chain");
+		BaseLayout<FirstBase>::FillHeadOffsets(anOffset, anOutOffsets);
+		(BaseLayout<NextBases>::FillBlockOffsets(anOffset + ComputePointerOffset<Type, NextBases>(), anOutOffsets), ...);
+	}
 
-	typeId_t mySize;
-	typeId_t myTypeId;
-	BaseTypeData<BaseTypes...> myBaseTypeData;
-	ptrdiff_t myEndMarker;
+	typeId_t myBuffer[ourDataSize + theTypeDataPaddingSize];
 };
 
 template<typename Type>
 struct TypeDataImpl<Type>
 {
-	TypeDataImpl() : mySize(1), myTypeId(GenerateId()), myEndMarker(0) {}
+	static constexpr typeId_t ourDepth = 0;
+	static constexpr size_t ourDataSize = 3;
+	static constexpr size_t ourOffsetCount = 0;
 
-	const char* GetData() const { return (char*)&myTypeId; }
+	KCL_RTTI_TYPEID_CONSTEXPR explicit TypeDataImpl(typeId_t aTypeId)
+		: myBuffer{1, aTypeId, 0}
+	{
+	}
 
-	typeId_t mySize;
-	typeId_t myTypeId;
-	ptrdiff_t myEndMarker;
+	static void FillOffsets(ptrdiff_t, typeOffset_t*&) {}
+
+	typeId_t myBuffer[ourDataSize + theTypeDataPaddingSize];
 };
 
+// Constant initialized for types without secondary blocks
+template<typename Type>
+constexpr TypeOffsets<TypeData<Type>::ourOffsetCount> ComputeTypeOffsets()
+{
+	TypeOffsets<TypeData<Type>::ourOffsetCount> offsets{};
+	if constexpr (TypeData<Type>::ourOffsetCount > 0)
+	{
+		// Bases are within the object, their offsets are smaller than its size
+		static_assert(sizeof(Type) <= (size_t)std::numeric_limits<typeOffset_t>::max(), "Type too large for KCL_RTTI_OFFSET_BITS");
+
+		typeOffset_t* outOffsets = offsets.myOffsets;
+		TypeData<Type>::FillOffsets(0, outOffsets);
+	}
+	return offsets;
+}
+
+// The type data immediately follows the type info
+static_assert(sizeof(RTTI::TypeInfo) % alignof(typeId_t) == 0, "Type data must follow the type info without padding");
+
 template<typename T>
 struct TypeInfoImpl
 {
@@ -286,8 +990,6 @@ struct TypeInfoImpl
 	const TypeData<T> myData;
 };
 
-#pragma pack(pop)
-
 } // namespace RTTI_Private
 } // namespace KCL
 
@@ -297,17 +999,60 @@ KCL_FORCEINLINE Derived kcl_dynamic_cast(Base* aBasePtr)
 	return KCL::RTTI::DynamicCast<Derived, Base>(aBasePtr);
 }
 
+// Members common to all registration modes
+#define _KCL_RTTI_TYPEINFO_MEMBERS(TYPE)                                                                                                   \
+	static const TypeOffsets<TypeData<TYPE>::ourOffsetCount> ourOffsets;                                                                   \
+	static const TypeRegistration ourRegistration;
+
+#define _KCL_RTTI_TYPEINFO_DEFINITIONS(TYPE)                                                                                               \
+	inline const TypeOffsets<TypeData<TYPE>::ourOffsetCount> GetTypeInfo<TYPE>::ourOffsets = ComputeTypeOffsets<TYPE>();                   \
+	inline const TypeRegistration GetTypeInfo<TYPE>::ourRegistration(&GetTypeInfo<TYPE>::Get);
+
 // Common declaration
-#define KCL_RTTI_TYPEINFO(TYPE)                                                                                                            \
+#if KCL_RTTI_HASHED_TYPEID
+// The type info is a constant expression placed in read only memory, there is nothing to create
+#	define KCL_RTTI_TYPEINFO(TYPE)                                                                                                         \
 	template<>                                                                                                                             \
 	struct GetTypeInfo<TYPE>                                                                                                               \
 	{                                                                                                                                      \
+		_KCL_RTTI_TYPEINFO_MEMBERS(TYPE)                                                                                                   \
+		static constexpr KCL::RTTI::typeId_t ourTypeId = KCL::RTTI::HashTypeName(KCL_TOSTRING(TYPE));                                      \
+		static constexpr TypeInfoImpl<TYPE> ourInstance = {                                                                                \
+			{KCL_TOSTRING(TYPE), ourOffsets.myOffsets, &TypeFields<TYPE>::ourFields,                                                       \
+				&GetObjectTraits<TYPE>}, TypeData<TYPE>(ourTypeId)};                                                                       \
+		KCL_FORCEINLINE static constexpr const KCL::RTTI::TypeInfo* Get() { return &ourInstance.myInfo; }                                  \
+	};                                                                                                                                     \
+	_KCL_RTTI_TYPEINFO_DEFINITIONS(TYPE)
+#elif KCL_RTTI_EAGER_REGISTRATION
+// Inline variables are initialized in order of definition, bases being registered first they are created first
+#	define KCL_RTTI_TYPEINFO(TYPE)                                                                                                         \
+	template<>                                                                                                                             \
+	struct GetTypeInfo<TYPE>                                                                                                               \
+	{                                                                                                                                      \
+		_KCL_RTTI_TYPEINFO_MEMBERS(TYPE)                                                                                                   \
+		static const TypeInfoImpl<TYPE> ourInstance;                                                                                       \
+		KCL_FORCEINLINE static const KCL::RTTI::TypeInfo* Get() { return &ourInstance.myInfo; }                                            \
+	};                                                                                                                                     \
+	inline const TypeInfoImpl<TYPE> GetTypeInfo<TYPE>::ourInstance = {                                                                     \
+		{KCL_TOSTRING(TYPE), GetTypeInfo<TYPE>::ourOffsets.myOffsets, &TypeFields<TYPE>::ourFields,                                        \
+			&GetObjectTraits<TYPE>}, TypeData<TYPE>(GenerateId())};                                                                        \
+	_KCL_RTTI_TYPEINFO_DEFINITIONS(TYPE)
+#else
+#	define KCL_RTTI_TYPEINFO(TYPE)                                                                                                         \
+	template<>                                                                                                                             \
+	struct GetTypeInfo<TYPE>                                                                                                               \
+	{                                                                                                                                      \
+		_KCL_RTTI_TYPEINFO_MEMBERS(TYPE)                                                                                                   \
 		static const KCL::RTTI::TypeInfo* Get()                                                                                            \
 		{                                                                                                                                  \
-			static TypeInfoImpl<TYPE> ourInstance = {{#TYPE}, TypeData<TYPE>()};                                                           \
+			static const TypeInfoImpl<TYPE> ourInstance = {                                                                                \
+				{KCL_TOSTRING(TYPE), ourOffsets.myOffsets, &TypeFields<TYPE>::ourFields,                                                   \
+					&GetObjectTraits<TYPE>}, TypeData<TYPE>(GenerateId())};                                                                \
 			return &ourInstance.myInfo;                                                                                                    \
 		}                                                                                                                                  \
-	};
+	};                                                                                                                                     \
+	_KCL_RTTI_TYPEINFO_DEFINITIONS(TYPE)
+#endif
 
 // Use for all types, must include all directly inherited types in the macro
 // Note: Ideally we could remove the Register macro by making it possible to register it all from withing the class,
@@ -320,6 +1065,7 @@ KCL_FORCEINLINE Derived kcl_dynamic_cast(Base* aBasePtr)
 	template<>                                                                                                                             \
 	struct TypeData<KCL_FIRST_ARG(__VA_ARGS__)> : public TypeDataImpl<__VA_ARGS__>                                                         \
 	{                                                                                                                                      \
+		using TypeDataImpl<__VA_ARGS__>::TypeDataImpl;                                                                                     \
 	};                                                                                                                                     \
 	KCL_RTTI_TYPEINFO(KCL_FIRST_ARG(__VA_ARGS__))                                                                                          \
 	}                                                                                                                                      \
@@ -328,10 +1074,10 @@ KCL_FORCEINLINE Derived kcl_dynamic_cast(Base* aBasePtr)
 // Use in the body of all polymorphic types
 #define KCL_RTTI_IMPL()                                                                                                                    \
                                                                                                                                            \
-	virtual intptr_t KCL_RTTI_DynamicCast(KCL::RTTI::typeId_t aOtherTypeId) const                                                          \
+	virtual intptr_t KCL_RTTI_DynamicCast(KCL::RTTI::typeId_t aOtherTypeId, KCL::RTTI::typeId_t aOtherDepth) const                         \
 	{                                                                                                                                      \
 		typedef std::remove_pointer<decltype(this)>::type ObjectType;                                                                      \
-		return KCL::RTTI::template GetTypeInfo<ObjectType>()->CastTo((intptr_t)this, aOtherTypeId);                                        \
+		return KCL::RTTI::template GetTypeInfo<ObjectType>()->CastTo((intptr_t)this, aOtherTypeId, aOtherDepth);                           \
 	}                                                                                                                                      \
 	virtual const KCL::RTTI::TypeInfo* KCL_RTTI_GetTypeInfo() const                                                                        \
 	{                                                                                                                                      \
@@ -342,5 +1088,5 @@ KCL_FORCEINLINE Derived kcl_dynamic_cast(Base* aBasePtr)
 	virtual KCL::RTTI::typeId_t KCL_RTTI_GetTypeId() const                                                                                 \
 	{                                                                                                                                      \
 		typedef std::remove_pointer<decltype(this)>::type ObjectType;                                                                      \
-		return KCL::RTTI::template GetTypeId<ObjectType>();                                                                                \
+		return KCL::RTTI::template GetTypeInfo<ObjectType>()->GetTypeId();                                                                 \
 	}
@@ -0,0 +1,567 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	define KCL_RTTI_ARCHIVE_MMAP 1
+#else
+#	define KCL_RTTI_ARCHIVE_MMAP 0
+#endif
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Fields.h"
+#include "KCL_RTTI_Registry.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Archive of registered objects loaded in place, for data that is loaded as a whole like a level.
+// Objects are copied as they are in memory, with the index of their type in the archive in place of their vtable pointer.
+// Loading maps the file and patches the vtable pointers of each object from a default constructed object of the same
+// type, there is no allocation or parsing per object.
+// The archive lists its types by name with a hash of their layout: size, alignment, bases with their offsets and fields.
+// A type that is not registered or whose layout changed fails the load instead of producing broken objects.
+// Note:
+// * Archived types are default constructible, the fields they declare with KCL_RTTI_FIELDS are trivially copyable.
+//   All the members are copied, listed or not, they must not point to memory or own resources.
+// * Vtable pointers are expected at the start of the object and of its polymorphic bases, as done by the common ABIs.
+//   Virtual inheritance is not supported.
+// * Objects are never constructed nor destroyed by the archive, they live as long as it is loaded.
+// * Files are mapped with private pages on POSIX systems, patching touches each page once. Other platforms read them.
+
+/*Usage :
+
+KCL::RTTI::ArchiveWriter writer;
+for (const Entity* entity : entities)
+	writer.Add(entity);
+writer.Save("Level.archive");
+
+KCL::RTTI::ObjectArchive archive;
+if (archive.Load("Level.archive") != KCL::RTTI::ArchiveResult::Ok)
+	printf("Cannot load %s\n", archive.GetErrorTypeName());
+for (size_t i = 0; i < archive.GetObjectCount(); ++i)
+	Spawn(archive.Get<Entity>(i));
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+enum class ArchiveResult
+{
+	Ok,
+	CannotOpen,
+	// Not an archive, another format version or pointer size, or corrupted data
+	InvalidFormat,
+	// A type of the archive is not registered or not default constructible
+	UnknownType,
+	// A type of the archive has another layout in this build
+	LayoutMismatch
+};
+} // namespace RTTI
+
+namespace RTTI_Private
+{
+// The file is the header, the types, the offsets of the objects, the type names and the objects
+struct ArchiveHeader
+{
+	uint32_t myMagic;
+	uint16_t myVersion;
+	uint16_t myPointerSize;
+	uint32_t myTypeCount;
+	uint32_t myObjectCount;
+	// Largest alignment of the objects, the archive is loaded at an address aligned to it
+	uint32_t myObjectAlignment;
+	uint32_t myPadding;
+	uint64_t mySize;
+};
+
+struct ArchiveType
+{
+	uint64_t myLayoutHash;
+	uint32_t myNameOffset;
+	// Bit i is set if the subobject i holds a vtable pointer, see GetSubobjectOffsets
+	uint32_t myVtableMask;
+};
+
+// "KCLA"
+constexpr uint32_t theArchiveMagic = 0x414C434B;
+constexpr uint16_t theArchiveVersion = 1;
+// Covers the page alignment of mapped files
+constexpr uint32_t theMaxArchiveAlignment = 64;
+constexpr size_t theMaxSubobjectCount = 32;
+
+// Offsets of the subobjects starting a block of the type data: the object itself, then its secondary bases
+inline size_t GetSubobjectOffsets(const RTTI::TypeInfo* aTypeInfo, size_t* someOffsetsOut)
+{
+	size_t count = 0;
+	someOffsetsOut[count++] = 0;
+	const typeId_t* block = aTypeInfo->GetTypeData();
+	for (block += *block + 1; *block != 0 && count < theMaxSubobjectCount; block += *block + 1, ++count)
+		someOffsetsOut[count] = (size_t)aTypeInfo->myOffsets[count - 1];
+	assert(*block == 0 && "Too many secondary bases to archive the type");
+	return count;
+}
+
+// FNV-1a
+inline uint64_t HashLayoutBytes(uint64_t aHash, const void* someBytes, size_t aSize)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(someBytes);
+	for (size_t i = 0; i < aSize; ++i)
+		aHash = (aHash ^ bytes[i]) * 0x100000001B3ull;
+	return aHash;
+}
+
+inline uint64_t HashLayoutValue(uint64_t aHash, uint64_t aValue)
+{
+	return HashLayoutBytes(aHash, &aValue, sizeof(aValue));
+}
+
+inline uint64_t HashLayoutName(uint64_t aHash, const char* aName)
+{
+	return HashLayoutBytes(aHash, aName, strlen(aName) + 1);
+}
+
+// Bases are hashed by name, their ids are not stable between builds
+inline uint64_t ComputeLayoutHash(const RTTI::TypeInfo* aTypeInfo)
+{
+	const RTTI::ObjectTraits& traits = aTypeInfo->GetObjectTraits();
+	uint64_t hash = HashLayoutName(0xCBF29CE484222325ull, aTypeInfo->GetName());
+	hash = HashLayoutValue(hash, traits.mySize);
+	hash = HashLayoutValue(hash, traits.myAlignment);
+
+	const RTTI::TypeRegistry& registry = RTTI::TypeRegistry::GetInstance();
+	size_t blockIndex = 0;
+	for (const typeId_t* block = aTypeInfo->GetTypeData(); *block != 0; block += *block + 1, ++blockIndex)
+	{
+		hash = HashLayoutValue(hash, blockIndex == 0 ? 0 : (uint64_t)aTypeInfo->myOffsets[blockIndex - 1]);
+		for (typeId_t i = 1; i <= *block; ++i)
+		{
+			const RTTI::TypeInfo* base = registry.FindById(block[i]);
+			hash = HashLayoutName(hash, base ? base->GetName() : "");
+		}
+	}
+
+	for (const RTTI::FieldInfo& field : aTypeInfo->GetFields())
+	{
+		hash = HashLayoutName(hash, field.myName);
+		hash = HashLayoutValue(hash, field.myOffset);
+		hash = HashLayoutValue(hash, field.mySize);
+		hash = HashLayoutValue(hash, (uint64_t)field.myKind);
+	}
+	return hash;
+}
+
+KCL_FORCEINLINE size_t AlignArchiveOffset(size_t anOffset, size_t anAlignment)
+{
+	return (anOffset + anAlignment - 1) & ~(anAlignment - 1);
+}
+} // namespace RTTI_Private
+
+namespace RTTI
+{
+class ArchiveWriter
+{
+public:
+	// Copies the object with its dynamic type, returns its index in the archive
+	template<typename T>
+	size_t Add(const T* anObject)
+	{
+		const TypeInfo* typeInfo = nullptr;
+		const intptr_t object = GetMostDerived(anObject, typeInfo);
+		assert(object && "Null objects cannot be archived");
+		return AddObject(object, typeInfo);
+	}
+
+	// anObject is the address of an object whose most derived type is aTypeInfo
+	size_t AddObject(intptr_t anObject, const TypeInfo* aTypeInfo)
+	{
+		const FieldList& fields = aTypeInfo->GetFields();
+		const ObjectTraits& traits = aTypeInfo->GetObjectTraits();
+		assert(traits.myNew && "Archived types are default constructible");
+		assert(traits.myAlignment <= RTTI_Private::theMaxArchiveAlignment && "Over aligned types are not supported");
+		for (const FieldRun* run = fields.GetRunsBegin(); run != fields.GetRunsEnd(); ++run)
+			assert(!run->myField && "Archived types have trivially copyable fields only");
+
+		const uint32_t* typeIndex = myTypeIndices.Find(aTypeInfo->GetTypeId());
+		if (!typeIndex)
+		{
+			typeIndex = &myTypeIndices.Add(aTypeInfo->GetTypeId(), (uint32_t)myTypes.size());
+			myTypes.push_back(aTypeInfo);
+		}
+
+		const size_t offset = RTTI_Private::AlignArchiveOffset(myObjects.size(), traits.myAlignment);
+		myObjects.resize(offset + traits.mySize);
+		memcpy(myObjects.data() + offset, reinterpret_cast<const void*>(anObject), traits.mySize);
+		myObjectOffsets.push_back(offset);
+		myObjectTypes.push_back(*typeIndex);
+		return myObjectOffsets.size() - 1;
+	}
+
+	KCL_FORCEINLINE size_t GetObjectCount() const { return myObjectOffsets.size(); }
+
+	void Write(std::vector<uint8_t>& someBytesOut) const
+	{
+		using namespace RTTI_Private;
+
+		// Words found in all the objects of a type and in a default constructed one are vtable pointers
+		struct Subobjects
+		{
+			size_t myCount;
+			size_t myOffsets[theMaxSubobjectCount];
+			uintptr_t myVtables[theMaxSubobjectCount];
+		};
+
+		std::vector<ArchiveType> types(myTypes.size());
+		std::vector<Subobjects> subobjects(myTypes.size());
+		for (size_t i = 0; i < myTypes.size(); ++i)
+		{
+			const ObjectTraits& traits = myTypes[i]->GetObjectTraits();
+			Subobjects& typeSubobjects = subobjects[i];
+			typeSubobjects.myCount = GetSubobjectOffsets(myTypes[i], typeSubobjects.myOffsets);
+			const intptr_t prototype = (intptr_t)traits.myNew();
+			for (size_t j = 0; j < typeSubobjects.myCount; ++j)
+				typeSubobjects.myVtables[j] = *reinterpret_cast<const uintptr_t*>(prototype + typeSubobjects.myOffsets[j]);
+			traits.myDelete((void*)prototype);
+
+			types[i].myLayoutHash = ComputeLayoutHash(myTypes[i]);
+			types[i].myVtableMask = (uint32_t)((uint64_t(1) << typeSubobjects.myCount) - 1);
+		}
+
+		for (size_t i = 0; i < myObjectOffsets.size(); ++i)
+		{
+			const uint32_t typeIndex = myObjectTypes[i];
+			const Subobjects& typeSubobjects = subobjects[typeIndex];
+			for (size_t j = 0; j < typeSubobjects.myCount; ++j)
+			{
+				uintptr_t word;
+				memcpy(&word, myObjects.data() + myObjectOffsets[i] + typeSubobjects.myOffsets[j], sizeof(word));
+				if (word != typeSubobjects.myVtables[j])
+					types[typeIndex].myVtableMask &= ~(1u << j);
+			}
+			assert((types[typeIndex].myVtableMask & 1) && "The vtable pointer of an object does not match its type");
+		}
+
+		// Layout of the file
+		const size_t typesOffset = sizeof(ArchiveHeader);
+		const size_t objectOffsetsOffset = typesOffset + types.size() * sizeof(ArchiveType);
+		size_t namesSize = 0;
+		for (size_t i = 0; i < myTypes.size(); ++i)
+		{
+			types[i].myNameOffset = (uint32_t)(objectOffsetsOffset + myObjectOffsets.size() * sizeof(uint64_t) + namesSize);
+			namesSize += strlen(myTypes[i]->GetName()) + 1;
+		}
+		const size_t objectsOffset = AlignArchiveOffset(objectOffsetsOffset + myObjectOffsets.size() * sizeof(uint64_t) + namesSize,
+														theMaxArchiveAlignment);
+
+		ArchiveHeader header = {};
+		header.myMagic = theArchiveMagic;
+		header.myVersion = theArchiveVersion;
+		header.myPointerSize = (uint16_t)sizeof(void*);
+		header.myTypeCount = (uint32_t)types.size();
+		header.myObjectCount = (uint32_t)myObjectOffsets.size();
+		header.myObjectAlignment = 1;
+		for (const TypeInfo* typeInfo : myTypes)
+			header.myObjectAlignment = std::max(header.myObjectAlignment, typeInfo->GetObjectTraits().myAlignment);
+		header.mySize = objectsOffset + myObjects.size();
+
+		someBytesOut.assign((size_t)header.mySize, 0);
+		uint8_t* bytes = someBytesOut.data();
+		memcpy(bytes, &header, sizeof(header));
+		if (!types.empty())
+			memcpy(bytes + typesOffset, types.data(), types.size() * sizeof(ArchiveType));
+		for (size_t i = 0; i < myObjectOffsets.size(); ++i)
+		{
+			const uint64_t offset = objectsOffset + myObjectOffsets[i];
+			memcpy(bytes + objectOffsetsOffset + i * sizeof(uint64_t), &offset, sizeof(offset));
+		}
+		for (size_t i = 0; i < myTypes.size(); ++i)
+			memcpy(bytes + types[i].myNameOffset, myTypes[i]->GetName(), strlen(myTypes[i]->GetName()) + 1);
+		if (!myObjects.empty())
+			memcpy(bytes + objectsOffset, myObjects.data(), myObjects.size());
+
+		// The type index replaces the main vtable pointer, the other ones are cleared
+		for (size_t i = 0; i < myObjectOffsets.size(); ++i)
+		{
+			const uint32_t typeIndex = myObjectTypes[i];
+			uint8_t* object = bytes + objectsOffset + myObjectOffsets[i];
+			const Subobjects& typeSubobjects = subobjects[typeIndex];
+			for (size_t j = 0; j < typeSubobjects.myCount; ++j)
+			{
+				if (types[typeIndex].myVtableMask & (1u << j))
+				{
+					const uintptr_t word = j == 0 ? (uintptr_t)typeIndex : 0;
+					memcpy(object + typeSubobjects.myOffsets[j], &word, sizeof(word));
+				}
+			}
+		}
+	}
+
+	bool Save(const char* aPath) const
+	{
+		std::vector<uint8_t> bytes;
+		Write(bytes);
+
+		FILE* file = fopen(aPath, "wb");
+		if (!file)
+			return false;
+		const bool isWritten = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		return fclose(file) == 0 && isWritten;
+	}
+
+private:
+	std::vector<const TypeInfo*> myTypes;
+	TypeMap<uint32_t> myTypeIndices;
+	std::vector<uint8_t> myObjects;
+	std::vector<size_t> myObjectOffsets;
+	std::vector<uint32_t> myObjectTypes;
+};
+
+class ObjectArchive
+{
+public:
+	ObjectArchive()
+		: myData(nullptr)
+		, myMappedSize(0)
+	{
+	}
+
+	~ObjectArchive() { Release(); }
+
+	ObjectArchive(const ObjectArchive&) = delete;
+	ObjectArchive& operator=(const ObjectArchive&) = delete;
+
+	// Maps the file with private pages and patches the objects in place
+	ArchiveResult Load(const char* aPath)
+	{
+		Release();
+
+#if KCL_RTTI_ARCHIVE_MMAP
+		const int file = open(aPath, O_RDONLY);
+		if (file < 0)
+			return ArchiveResult::CannotOpen;
+
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+			data = mmap(nullptr, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		close(file);
+		if (data == MAP_FAILED)
+			return ArchiveResult::CannotOpen;
+
+		myMappedSize = (size_t)status.st_size;
+		return Patch(static_cast<uint8_t*>(data), myMappedSize);
+#else
+		FILE* file = fopen(aPath, "rb");
+		if (!file)
+			return ArchiveResult::CannotOpen;
+
+		fseek(file, 0, SEEK_END);
+		const long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if (size <= 0)
+		{
+			fclose(file);
+			return ArchiveResult::CannotOpen;
+		}
+
+		// Aligned like a mapping would be
+		myBuffer.reset(new uint8_t[(size_t)size + RTTI_Private::theMaxArchiveAlignment]);
+		uint8_t* data = myBuffer.get() + (-(intptr_t)myBuffer.get() & (RTTI_Private::theMaxArchiveAlignment - 1));
+		const bool isRead = fread(data, 1, (size_t)size, file) == (size_t)size;
+		fclose(file);
+		return isRead ? Patch(data, (size_t)size) : ArchiveResult::CannotOpen;
+#endif
+	}
+
+	// Patches an archive in memory, someData is left partially patched if the load fails.
+	// It must outlive the archive and be aligned like a mapped file, to the largest alignment of the objects
+	ArchiveResult LoadFromMemory(void* someData, size_t aSize)
+	{
+		Release();
+		return Patch(static_cast<uint8_t*>(someData), aSize);
+	}
+
+	// Unmaps the file, the objects must not be used anymore
+	void Release()
+	{
+#if KCL_RTTI_ARCHIVE_MMAP
+		if (myMappedSize > 0)
+			munmap(myData, myMappedSize);
+#else
+		myBuffer.reset();
+#endif
+		myData = nullptr;
+		myMappedSize = 0;
+		myObjects.clear();
+	}
+
+	KCL_FORCEINLINE size_t GetObjectCount() const { return myObjects.size(); }
+	KCL_FORCEINLINE const TypeInfo* GetTypeInfo(size_t anIndex) const { return myObjects[anIndex].myTypeInfo; }
+	// Address of the most derived object
+	KCL_FORCEINLINE intptr_t GetObject(size_t anIndex) const { return myObjects[anIndex].myAddress; }
+
+	// nullptr if the object is not a T
+	template<typename T>
+	KCL_FORCEINLINE T* Get(size_t anIndex) const
+	{
+		const Object& object = myObjects[anIndex];
+		return reinterpret_cast<T*>(object.myTypeInfo->CastTo(object.myAddress, GetTypeId<T>()));
+	}
+
+	// Type that made the load fail with UnknownType or LayoutMismatch
+	KCL_FORCEINLINE const char* GetErrorTypeName() const { return myErrorTypeName.c_str(); }
+
+private:
+	struct Object
+	{
+		intptr_t myAddress;
+		const TypeInfo* myTypeInfo;
+	};
+
+	struct LoadedType
+	{
+		const TypeInfo* myTypeInfo;
+		uint32_t myObjectSize;
+		uint32_t myObjectAlignment;
+		uint32_t myVtableMask;
+		size_t mySubobjectCount;
+		size_t mySubobjectOffsets[RTTI_Private::theMaxSubobjectCount];
+		uintptr_t myVtables[RTTI_Private::theMaxSubobjectCount];
+	};
+
+	ArchiveResult Patch(uint8_t* someData, size_t aSize)
+	{
+		myData = someData;
+		myErrorTypeName.clear();
+		ArchiveResult result = PatchObjects(someData, aSize);
+		if (result != ArchiveResult::Ok)
+			Release();
+		return result;
+	}
+
+	ArchiveResult PatchObjects(uint8_t* someData, size_t aSize)
+	{
+		using namespace RTTI_Private;
+
+		ArchiveHeader header;
+		if (aSize < sizeof(header))
+			return ArchiveResult::InvalidFormat;
+		memcpy(&header, someData, sizeof(header));
+
+		const uint64_t tablesSize = sizeof(header) + (uint64_t)header.myTypeCount * sizeof(ArchiveType)
+									+ (uint64_t)header.myObjectCount * sizeof(uint64_t);
+		if (header.myMagic != theArchiveMagic || header.myVersion != theArchiveVersion || header.myPointerSize != sizeof(void*)
+			|| header.mySize != aSize || tablesSize > aSize || header.myObjectAlignment > theMaxArchiveAlignment
+			|| (header.myObjectAlignment & (header.myObjectAlignment - 1)) != 0
+			|| (uintptr_t)someData % header.myObjectAlignment != 0)
+		{
+			return ArchiveResult::InvalidFormat;
+		}
+
+		// Resolves the types by name, the vtable pointers are taken from a default constructed object
+		std::vector<LoadedType> types(header.myTypeCount);
+		const ArchiveType* archiveTypes = reinterpret_cast<const ArchiveType*>(someData + sizeof(header));
+		for (size_t i = 0; i < types.size(); ++i)
+		{
+			const uint32_t nameOffset = archiveTypes[i].myNameOffset;
+			const char* name = reinterpret_cast<const char*>(someData + nameOffset);
+			if (nameOffset >= aSize || !memchr(name, 0, aSize - nameOffset))
+				return ArchiveResult::InvalidFormat;
+
+			LoadedType& type = types[i];
+			type.myTypeInfo = TypeRegistry::GetInstance().FindByName(name);
+			if (!type.myTypeInfo || !type.myTypeInfo->GetObjectTraits().myNew)
+			{
+				myErrorTypeName = name;
+				return ArchiveResult::UnknownType;
+			}
+			if (ComputeLayoutHash(type.myTypeInfo) != archiveTypes[i].myLayoutHash)
+			{
+				myErrorTypeName = name;
+				return ArchiveResult::LayoutMismatch;
+			}
+
+			const ObjectTraits& traits = type.myTypeInfo->GetObjectTraits();
+			type.myObjectSize = traits.mySize;
+			type.myObjectAlignment = traits.myAlignment;
+			type.myVtableMask = archiveTypes[i].myVtableMask;
+			type.mySubobjectCount = GetSubobjectOffsets(type.myTypeInfo, type.mySubobjectOffsets);
+			if ((type.myVtableMask & 1) == 0 || (type.myVtableMask >> type.mySubobjectCount) != 0)
+				return ArchiveResult::InvalidFormat;
+
+			const intptr_t prototype = (intptr_t)traits.myNew();
+			for (size_t j = 0; j < type.mySubobjectCount; ++j)
+				type.myVtables[j] = *reinterpret_cast<const uintptr_t*>(prototype + type.mySubobjectOffsets[j]);
+			traits.myDelete((void*)prototype);
+		}
+
+		myObjects.resize(header.myObjectCount);
+		const uint8_t* objectOffsets = someData + sizeof(header) + types.size() * sizeof(ArchiveType);
+		for (size_t i = 0; i < myObjects.size(); ++i)
+		{
+			uint64_t offset;
+			memcpy(&offset, objectOffsets + i * sizeof(uint64_t), sizeof(offset));
+			uintptr_t typeIndex = types.size();
+			// Compared by difference, a corrupted offset close to the maximum would wrap around when added to
+			if (offset >= tablesSize && offset <= aSize - sizeof(uintptr_t))
+				memcpy(&typeIndex, someData + offset, sizeof(typeIndex));
+			if (typeIndex >= types.size())
+				return ArchiveResult::InvalidFormat;
+
+			const LoadedType& type = types[typeIndex];
+			if (type.myObjectSize > aSize - offset || offset % type.myObjectAlignment != 0)
+				return ArchiveResult::InvalidFormat;
+
+			uint8_t* object = someData + offset;
+			for (size_t j = 0; j < type.mySubobjectCount; ++j)
+				if (type.myVtableMask & (1u << j))
+					memcpy(object + type.mySubobjectOffsets[j], &type.myVtables[j], sizeof(uintptr_t));
+			myObjects[i] = Object{(intptr_t)object, type.myTypeInfo};
+		}
+		return ArchiveResult::Ok;
+	}
+
+	uint8_t* myData;
+	size_t myMappedSize;
+#if !KCL_RTTI_ARCHIVE_MMAP
+	std::unique_ptr<uint8_t[]> myBuffer;
+#endif
+	std::vector<Object> myObjects;
+	std::string myErrorTypeName;
+};
+} // namespace RTTI
+} // namespace KCL
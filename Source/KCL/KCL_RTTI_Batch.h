@@ -0,0 +1,172 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Registry.h"
+
+// Casts of whole arrays of base pointers.
+// Objects are prefetched ahead of the cast, so that scattered objects are brought in the cache while the previous ones
+// are cast. Once an object is in the cache, its type info is read and its type data prefetched, a few objects before
+// its cast. Each distinct dynamic type is resolved once per batch: the offset to the result is kept in a small table
+// indexed by type id, later objects of the same type only cost the virtual call returning their type info.
+// Note:
+// * When the source type is present several times in the dynamic type, the offset depends on the subobject pointed,
+//   objects of such a dynamic type are each cast with DynamicCast.
+
+/*Usage :
+
+// Writes one result per input, nullptr for failed casts
+KCL::RTTI::DynamicCastBatch<Derived>(basePtrs, count, derivedPtrs);
+
+// Writes only the successful casts and returns their count
+size_t derivedCount = KCL::RTTI::DynamicCastFilter<Derived>(basePtrs, count, derivedPtrs);
+
+*/
+
+namespace KCL
+{
+namespace RTTI_Private
+{
+// Number of objects whose type data is prefetched ahead of the one being cast
+static constexpr size_t theBatchTypeDataDistance = 8;
+// Number of objects prefetched ahead of the one being cast, they are in the cache once their type info is read
+static constexpr size_t theBatchPrefetchDistance = 2 * theBatchTypeDataDistance;
+
+// Offsets from the base pointer to the result, for the dynamic types resolved during a batch
+class BatchCastTable
+{
+public:
+	BatchCastTable()
+		: myEntries{}
+	{
+	}
+
+	// aTypeInfo is the dynamic type of the object
+	template<typename Derived, typename Base>
+	KCL_FORCEINLINE Derived* Cast(Base* aBasePtr, const RTTI::TypeInfo* aTypeInfo, RTTI::typeId_t anOtherTypeId,
+								  RTTI::typeId_t anOtherDepth)
+	{
+		// Type ids are never 0, which marks empty entries. Colliding types replace each other.
+		const RTTI::typeId_t typeId = aTypeInfo->GetTypeId();
+		Entry& entry = myEntries[typeId & (theSize - 1)];
+		if (entry.myTypeId != typeId)
+		{
+			const intptr_t result = aBasePtr->KCL_RTTI_DynamicCast(anOtherTypeId, anOtherDepth);
+			const intptr_t offset = result - (intptr_t)aBasePtr;
+			entry.myTypeId = typeId;
+			if (!result)
+				entry.myOffset = theFailedCastOffset;
+			else if (RTTI::TypeRegistry::CountTypeId(aTypeInfo, RTTI::GetTypeId<Base>()) > 1 || offset <= theAmbiguousOffset
+					 || offset > INT32_MAX)
+				entry.myOffset = theAmbiguousOffset;
+			else
+				entry.myOffset = (int32_t)offset;
+		}
+
+		if (entry.myOffset == theFailedCastOffset)
+			return nullptr;
+		if (entry.myOffset == theAmbiguousOffset)
+			return reinterpret_cast<Derived*>(aBasePtr->KCL_RTTI_DynamicCast(anOtherTypeId, anOtherDepth));
+		return reinterpret_cast<Derived*>((intptr_t)aBasePtr + entry.myOffset);
+	}
+
+private:
+	// Counter ids are dense, the low bits index the table without collisions up to this number of types
+	static constexpr size_t theSize = 64;
+
+	struct Entry
+	{
+		RTTI::typeId_t myTypeId;
+		int32_t myOffset;
+	};
+
+	Entry myEntries[theSize];
+};
+
+template<typename Derived, typename Base, typename Output>
+KCL_FORCEINLINE void DynamicCastBatch(Base* const* anInput, size_t aCount, Output anOutput)
+{
+	static_assert(!std::is_pointer<Derived>::value, "Pass the type to cast to, not a pointer");
+
+	if constexpr (std::is_base_of<Derived, Base>::value)
+	{
+		for (size_t i = 0; i < aCount; ++i)
+			anOutput(static_cast<Derived*>(anInput[i]));
+	}
+	else
+	{
+		const RTTI::typeId_t otherTypeId = RTTI::GetTypeId<Derived>();
+		const RTTI::typeId_t otherDepth = RTTI::GetTypeDepth<Derived>();
+		BatchCastTable table;
+
+		// Type info of the objects whose type data is prefetched, indexed by object index
+		const RTTI::TypeInfo* typeInfos[theBatchTypeDataDistance];
+		auto prefetchTypeData = [&](size_t anIndex) {
+			const RTTI::TypeInfo* typeInfo = anInput[anIndex] ? anInput[anIndex]->KCL_RTTI_GetTypeInfo() : nullptr;
+			if (typeInfo)
+				KCL_PREFETCH(typeInfo->GetTypeData());
+			typeInfos[anIndex % theBatchTypeDataDistance] = typeInfo;
+		};
+		for (size_t i = 0; i < aCount && i < theBatchTypeDataDistance; ++i)
+			prefetchTypeData(i);
+
+		for (size_t i = 0; i < aCount; ++i)
+		{
+			// Prefetching is a hint and never faults, even on a null pointer
+			if (i + theBatchPrefetchDistance < aCount)
+				KCL_PREFETCH(anInput[i + theBatchPrefetchDistance]);
+
+			const RTTI::TypeInfo* typeInfo = typeInfos[i % theBatchTypeDataDistance];
+			if (i + theBatchTypeDataDistance < aCount)
+				prefetchTypeData(i + theBatchTypeDataDistance);
+
+			anOutput(typeInfo ? table.template Cast<Derived>(anInput[i], typeInfo, otherTypeId, otherDepth) : nullptr);
+		}
+	}
+}
+} // namespace RTTI_Private
+
+namespace RTTI
+{
+// Casts aCount pointers, anOutput receives one result per input, nullptr if the cast failed
+template<typename Derived, typename Base>
+void DynamicCastBatch(Base* const* anInput, size_t aCount, Derived** anOutput)
+{
+	KCL::RTTI_Private::DynamicCastBatch<Derived>(anInput, aCount, [&anOutput](Derived* aResult) { *anOutput++ = aResult; });
+}
+
+// Casts aCount pointers, anOutput receives the successful casts in input order and must have room for aCount pointers.
+// Returns the number of results written.
+template<typename Derived, typename Base>
+size_t DynamicCastFilter(Base* const* anInput, size_t aCount, Derived** anOutput)
+{
+	Derived** output = anOutput;
+	KCL::RTTI_Private::DynamicCastBatch<Derived>(anInput, aCount, [&output](Derived* aResult) {
+		*output = aResult;
+		output += aResult != nullptr;
+	});
+	return output - anOutput;
+}
+} // namespace RTTI
+} // namespace KCL
@@ -0,0 +1,193 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Registry.h"
+
+// Records hits and misses of every cast cache, see CastCache::GetFirst to report them.
+// Caches with statistics are registered the first time they are used, which costs a guard check on every cast.
+#if !defined(KCL_RTTI_CAST_CACHE_STATS)
+#	define KCL_RTTI_CAST_CACHE_STATS 0
+#endif
+
+// Per call site cast cache, similar to the polymorphic inline caches of JIT compilers.
+// A call site usually sees the same few dynamic types, the cache remembers the offset from the source pointer to the
+// result for the last dynamic types seen. On a hit the cast is a virtual call to get the type id, a compare and an add,
+// instead of walking the type data. Failed casts are cached as well.
+// Note:
+// * Entries pack the source type id and the offset in a single atomic word, caches can be shared by several threads.
+// * The source pointer type must be the same for all the casts going through a cache, which is guaranteed per call site.
+// * When the source type is present several times in the dynamic type, the offset depends on the subobject pointed.
+//   The entry of such a dynamic type only records that its casts go through DynamicCast.
+
+/*Usage :
+
+Derived* derived = KCL_CACHED_DYNAMIC_CAST(Derived*, basePtr);
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+class CastCache
+{
+public:
+	// The last dynamic types seen, most recent first
+	static constexpr size_t theEntryCount = 4;
+
+#if KCL_RTTI_CAST_CACHE_STATS
+	CastCache(const char* aFile, int aLine)
+		: myEntries{}
+		, myHitCount(0)
+		, myMissCount(0)
+		, myFile(aFile)
+		, myLine(aLine)
+		, myNext(nullptr)
+	{
+		std::atomic<const CastCache*>& head = GetHead();
+		myNext = head.load(std::memory_order_relaxed);
+		while (!head.compare_exchange_weak(myNext, this, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// All the caches used so far are linked together
+	static const CastCache* GetFirst() { return GetHead().load(std::memory_order_acquire); }
+	const CastCache* GetNext() const { return myNext; }
+
+	const char* GetFile() const { return myFile; }
+	int GetLine() const { return myLine; }
+	uint64_t GetHitCount() const { return myHitCount.load(std::memory_order_relaxed); }
+	uint64_t GetMissCount() const { return myMissCount.load(std::memory_order_relaxed); }
+#else
+	constexpr CastCache()
+		: myEntries{}
+	{
+	}
+#endif
+
+	CastCache(const CastCache&) = delete;
+	CastCache& operator=(const CastCache&) = delete;
+
+	template<typename Derived, typename Base>
+	KCL_FORCEINLINE Derived Cast(Base* aBasePtr)
+	{
+		static_assert(std::is_pointer<Derived>::value, "Return type must be a pointer");
+		typedef typename std::remove_pointer<Derived>::type DerivedObjectType;
+
+		if constexpr (std::is_base_of<DerivedObjectType, Base>::value || std::is_final<DerivedObjectType>::value)
+			return DynamicCast<Derived>(aBasePtr); // Already a single compare at most
+		else
+		{
+			if (!aBasePtr)
+				return nullptr;
+
+			const typeId_t typeId = aBasePtr->KCL_RTTI_GetTypeId();
+			for (size_t i = 0; i < theEntryCount; ++i)
+			{
+				const uint64_t entry = myEntries[i].load(std::memory_order_relaxed);
+				if ((typeId_t)entry == typeId)
+				{
+#if KCL_RTTI_CAST_CACHE_STATS
+					myHitCount.fetch_add(1, std::memory_order_relaxed);
+#endif
+					const int32_t offset = (int32_t)(entry >> 32);
+					if (offset == RTTI_Private::theFailedCastOffset)
+						return nullptr;
+					if (offset == RTTI_Private::theAmbiguousOffset)
+						return DynamicCast<Derived>(aBasePtr);
+					return reinterpret_cast<Derived>((intptr_t)aBasePtr + offset);
+				}
+			}
+
+			return reinterpret_cast<Derived>(CastAndInsert(aBasePtr, typeId, GetTypeId<DerivedObjectType>(),
+														   GetTypeDepth<DerivedObjectType>()));
+		}
+	}
+
+private:
+	static_assert(sizeof(typeId_t) <= sizeof(uint32_t), "Entries pack the type id and the offset in 64 bits");
+
+	template<typename Base>
+	KCL_NOINLINE intptr_t CastAndInsert(Base* aBasePtr, typeId_t aTypeId, typeId_t anOtherTypeId, typeId_t anOtherDepth)
+	{
+		using namespace RTTI_Private;
+
+#if KCL_RTTI_CAST_CACHE_STATS
+		myMissCount.fetch_add(1, std::memory_order_relaxed);
+#endif
+		const intptr_t result = aBasePtr->KCL_RTTI_DynamicCast(anOtherTypeId, anOtherDepth);
+		intptr_t offset = theFailedCastOffset;
+		if (result)
+		{
+			const bool isAmbiguous = TypeRegistry::CountTypeId(aBasePtr->KCL_RTTI_GetTypeInfo(), GetTypeId<Base>()) > 1;
+			offset = isAmbiguous ? theAmbiguousOffset : result - (intptr_t)aBasePtr;
+		}
+		if (offset == theFailedCastOffset || offset == theAmbiguousOffset || (offset > theAmbiguousOffset && offset <= INT32_MAX))
+		{
+			// Concurrent misses may lose an entry, this only costs another miss later
+			const uint64_t entry = ((uint64_t)(uint32_t)(int32_t)offset << 32) | (uint32_t)aTypeId;
+			for (size_t i = theEntryCount - 1; i > 0; --i)
+				myEntries[i].store(myEntries[i - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			myEntries[0].store(entry, std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	// Type id in the low 32 bits, offset in the high 32 bits. Empty entries have the type id 0 which is never valid.
+	std::atomic<uint64_t> myEntries[theEntryCount];
+
+#if KCL_RTTI_CAST_CACHE_STATS
+	static std::atomic<const CastCache*>& GetHead()
+	{
+		static std::atomic<const CastCache*> theHead(nullptr);
+		return theHead;
+	}
+
+	std::atomic<uint64_t> myHitCount;
+	std::atomic<uint64_t> myMissCount;
+	const char* myFile;
+	int myLine;
+	const CastCache* myNext;
+#endif
+};
+} // namespace RTTI
+} // namespace KCL
+
+// The lambda is unique to the call site, and so is its cache
+#if KCL_RTTI_CAST_CACHE_STATS
+#	define _KCL_RTTI_CAST_CACHE_DECLARATION static KCL::RTTI::CastCache theCache(__FILE__, __LINE__)
+#else
+#	define _KCL_RTTI_CAST_CACHE_DECLARATION static KCL::RTTI::CastCache theCache
+#endif
+
+#define KCL_CACHED_DYNAMIC_CAST(DERIVED, PTR)                                                                                              \
+	([]() -> KCL::RTTI::CastCache& {                                                                                                       \
+		_KCL_RTTI_CAST_CACHE_DECLARATION;                                                                                                  \
+		return theCache;                                                                                                                   \
+	}().template Cast<DERIVED>(PTR))
@@ -0,0 +1,216 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "KCL_RTTI_Registry.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Precomputed offsets between all the types of a closed hierarchy, trading memory for speed.
+// The matrix has a row per dynamic type and a column per type, holding the offset from the most derived object to
+// each of its bases. Any upcast, downcast or cross-cast between types of the matrix reads the offset of the source
+// pointer and the offset of the result from the same row, instead of walking the type data.
+// The columns of the source and result types are resolved on the first cast of each pair of static types, and cached
+// per pair like the entries of CastCache. Later casts only look up the row of the dynamic type.
+// Note:
+// * The matrix is built from the registry, this must happen after static initialization.
+// * The matrix covers the registered types deriving from one of the roots. Types left out, because they are outside
+//   the roots or do not fit in the byte budget, fall back to DynamicCast.
+// * Casts from or to a base present several times in the dynamic type fall back to DynamicCast as well.
+
+/*Usage :
+
+// Covers all the types deriving from Base1 or Base2, in at most 16KB
+const KCL::RTTI::CastMatrix matrix({KCL::RTTI::GetTypeInfo<Base1>(), KCL::RTTI::GetTypeInfo<Base2>()}, 16 * 1024);
+
+Derived* derived = matrix.Cast<Derived*>(basePtr);
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+class CastMatrix
+{
+public:
+	CastMatrix(std::initializer_list<const TypeInfo*> someRoots, size_t aByteBudget)
+		: myTypeCount(0)
+		, mySerial(GetNextSerial().fetch_add(1, std::memory_order_relaxed))
+	{
+		std::vector<const TypeInfo*> types;
+		for (const TypeInfo* typeInfo : TypeRegistry::GetInstance())
+		{
+			for (const TypeInfo* root : someRoots)
+			{
+				if (RTTI_Private::GetBaseOffset(typeInfo, root->GetTypeId()) != RTTI_Private::theNotABaseOffset)
+				{
+					types.push_back(typeInfo);
+					break;
+				}
+			}
+		}
+
+		// Keeps the types that fit in the budget with their index table, the offsets alone rule out most types cheaply
+		while (types.size() > theNotFoundColumn || types.size() * types.size() * sizeof(int32_t) > aByteBudget)
+			types.pop_back();
+		for (; !types.empty(); types.pop_back())
+		{
+			myIndices = BuildIndices(types);
+			if (types.size() * types.size() * sizeof(int32_t) + myIndices.GetByteSize() <= aByteBudget)
+				break;
+		}
+
+		myTypeCount = (uint32_t)types.size();
+		if (myTypeCount == 0)
+		{
+			myIndices.Clear();
+			return;
+		}
+
+		myOffsets.resize((size_t)myTypeCount * myTypeCount);
+		for (uint32_t row = 0; row < myTypeCount; ++row)
+		{
+			for (uint32_t column = 0; column < myTypeCount; ++column)
+			{
+				const typeId_t typeId = types[column]->GetTypeId();
+				const intptr_t delta = RTTI_Private::GetBaseOffset(types[row], typeId);
+				int32_t& offset = myOffsets[(size_t)row * myTypeCount + column];
+				if (delta == RTTI_Private::theNotABaseOffset)
+					offset = RTTI_Private::theFailedCastOffset;
+				else if (TypeRegistry::CountTypeId(types[row], typeId) > 1 || delta <= RTTI_Private::theAmbiguousOffset
+						 || delta > INT32_MAX)
+					offset = RTTI_Private::theAmbiguousOffset;
+				else
+					offset = (int32_t)delta;
+			}
+		}
+	}
+
+	template<typename Derived, typename Base>
+	KCL_FORCEINLINE Derived Cast(Base* aBasePtr) const
+	{
+		static_assert(std::is_pointer<Derived>::value, "Return type must be a pointer");
+		typedef typename std::remove_pointer<Derived>::type DerivedObjectType;
+
+		if constexpr (std::is_base_of<DerivedObjectType, Base>::value)
+			return static_cast<Derived>(aBasePtr);
+		else
+		{
+			if (!aBasePtr)
+				return nullptr;
+
+			const uint32_t row = FindIndex(aBasePtr->KCL_RTTI_GetTypeId());
+			const uint32_t columns = GetColumns<DerivedObjectType, Base>();
+			const uint32_t sourceColumn = columns & theNotFoundColumn;
+			const uint32_t resultColumn = columns >> 16;
+			if (row != theNotFoundIndex && sourceColumn != theNotFoundColumn && resultColumn != theNotFoundColumn)
+			{
+				const int32_t* offsets = myOffsets.data() + (size_t)row * myTypeCount;
+				const int32_t sourceOffset = offsets[sourceColumn];
+				const int32_t resultOffset = offsets[resultColumn];
+
+				// The source offset is never a failed cast, the object is a Base
+				if (sourceOffset != RTTI_Private::theAmbiguousOffset && resultOffset != RTTI_Private::theAmbiguousOffset)
+				{
+					return resultOffset != RTTI_Private::theFailedCastOffset
+							   ? reinterpret_cast<Derived>((intptr_t)aBasePtr - sourceOffset + resultOffset)
+							   : nullptr;
+				}
+			}
+
+			return DynamicCast<Derived>(aBasePtr);
+		}
+	}
+
+	KCL_FORCEINLINE size_t GetTypeCount() const { return myTypeCount; }
+
+	// Memory used by the offsets and the index table
+	KCL_FORCEINLINE size_t GetByteSize() const
+	{
+		return myOffsets.size() * sizeof(int32_t) + myIndices.GetByteSize();
+	}
+
+	KCL_FORCEINLINE bool Contains(const TypeInfo* aTypeInfo) const { return FindIndex(aTypeInfo->GetTypeId()) != theNotFoundIndex; }
+
+private:
+	static constexpr uint32_t theNotFoundIndex = UINT32_MAX;
+	// Columns are packed by pairs in 32 bits
+	static constexpr uint32_t theNotFoundColumn = 0xFFFF;
+
+	// Source column in the low 16 bits, result column in the high 16 bits
+	template<typename Derived, typename Base>
+	KCL_FORCEINLINE uint32_t GetColumns() const
+	{
+		// Matrix serial in the low 32 bits, columns in the high 32 bits. Serials start at 1, 0 is an empty entry.
+		static std::atomic<uint64_t> theColumns(0);
+		const uint64_t entry = theColumns.load(std::memory_order_relaxed);
+		if ((uint32_t)entry == mySerial)
+			return (uint32_t)(entry >> 32);
+		return ResolveColumns(theColumns, GetTypeId<Base>(), GetTypeId<Derived>());
+	}
+
+	KCL_NOINLINE uint32_t ResolveColumns(std::atomic<uint64_t>& someColumns, typeId_t aSourceTypeId, typeId_t aResultTypeId) const
+	{
+		const uint32_t sourceColumn = std::min(FindIndex(aSourceTypeId), theNotFoundColumn);
+		const uint32_t resultColumn = std::min(FindIndex(aResultTypeId), theNotFoundColumn);
+		const uint32_t columns = sourceColumn | (resultColumn << 16);
+
+		// Casts of the same pair through other matrices replace the entry, this only costs another resolution later
+		someColumns.store(((uint64_t)columns << 32) | mySerial, std::memory_order_relaxed);
+		return columns;
+	}
+
+	static std::atomic<uint32_t>& GetNextSerial()
+	{
+		static std::atomic<uint32_t> theNextSerial(1);
+		return theNextSerial;
+	}
+
+	KCL_FORCEINLINE uint32_t FindIndex(typeId_t aTypeId) const
+	{
+		const uint32_t* index = myIndices.Find(aTypeId);
+		return index ? *index : theNotFoundIndex;
+	}
+
+	static TypeMap<uint32_t> BuildIndices(const std::vector<const TypeInfo*>& someTypes)
+	{
+		TypeMap<uint32_t> indices;
+		for (uint32_t i = 0; i < (uint32_t)someTypes.size(); ++i)
+			indices.Add(someTypes[i]->GetTypeId(), i);
+		return indices;
+	}
+
+	std::vector<int32_t> myOffsets;
+	TypeMap<uint32_t> myIndices;
+	uint32_t myTypeCount;
+	uint32_t mySerial;
+};
+} // namespace RTTI
+} // namespace KCL
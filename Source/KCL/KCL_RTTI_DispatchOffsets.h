@@ -0,0 +1,83 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Registry.h"
+
+// Offsets shared by the dispatch tables of Match and Dispatcher2, see KCL_RTTI_Match.h and KCL_RTTI_Dispatcher.h.
+// A table stores the offset from a base of the object to the argument of the function chosen for its type, so that a
+// dispatch adds it to the pointer instead of casting.
+// Note:
+// * When the base or the argument type is present several times in the type, the offset depends on the subobject
+//   pointed. Such offsets are theAmbiguousOffset, and AdjustArgument casts the argument with DynamicCast instead.
+
+/*Usage :
+
+const int32_t baseOffset = KCL::RTTI_Private::ComputeBaseOffset(typeInfo, KCL::RTTI::GetTypeId<Base>());
+const int32_t offset = KCL::RTTI_Private::ComputeArgumentOffset(typeInfo, baseOffset, KCL::RTTI::GetTypeInfo<Argument>());
+
+Argument* argument = KCL::RTTI_Private::AdjustArgument<Argument>(basePtr, offset);
+
+*/
+
+namespace KCL
+{
+namespace RTTI_Private
+{
+inline bool IsA(const RTTI::TypeInfo* aTypeInfo, const RTTI::TypeInfo* aBaseTypeInfo)
+{
+	return GetBaseOffset(aTypeInfo, aBaseTypeInfo->GetTypeId()) != theNotABaseOffset;
+}
+
+// Offset of the base in the most derived object, theAmbiguousOffset if the base is present several times in the type
+inline int32_t ComputeBaseOffset(const RTTI::TypeInfo* aTypeInfo, RTTI::typeId_t aBaseTypeId)
+{
+	if (RTTI::TypeRegistry::CountTypeId(aTypeInfo, aBaseTypeId) > 1)
+		return theAmbiguousOffset;
+	return (int32_t)GetBaseOffset(aTypeInfo, aBaseTypeId);
+}
+
+// Offset from the base to the argument of a handler
+inline int32_t ComputeArgumentOffset(const RTTI::TypeInfo* aTypeInfo, int32_t aBaseOffset, const RTTI::TypeInfo* anArgumentTypeInfo)
+{
+	if (aBaseOffset == theAmbiguousOffset || RTTI::TypeRegistry::CountTypeId(aTypeInfo, anArgumentTypeInfo->GetTypeId()) > 1)
+		return theAmbiguousOffset;
+	return (int32_t)GetBaseOffset(aTypeInfo, anArgumentTypeInfo->GetTypeId()) - aBaseOffset;
+}
+
+template<typename T, typename Base>
+KCL_FORCEINLINE T* AdjustArgument(Base* aBasePtr, int32_t anOffset)
+{
+	if constexpr (std::is_same<typename std::remove_cv<T>::type, typename std::remove_cv<Base>::type>::value)
+		return aBasePtr;
+	else if (anOffset != theAmbiguousOffset)
+		return reinterpret_cast<T*>((intptr_t)aBasePtr + anOffset);
+	else
+		return RTTI::DynamicCast<T*>(aBasePtr);
+}
+} // namespace RTTI_Private
+} // namespace KCL
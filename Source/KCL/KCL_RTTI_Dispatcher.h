@@ -0,0 +1,267 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_DispatchOffsets.h"
+#include "KCL_RTTI_Registry.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Dispatcher2 dispatches on the dynamic types of two objects, to handle the collisions or interactions of game objects.
+// Handlers are functions taking pointers to two registered types, added for a pair of types and all the types deriving
+// from them. The dispatcher keeps a table with a row per registered type deriving from BaseA and a column per registered
+// type deriving from BaseB, each cell holding the most specific handler of the pair and the offsets of its arguments.
+// A dispatch reads the type ids of both objects, then the cell, and makes a single indirect call.
+// Note:
+// * The most specific handler is the one whose first type is the most derived, then whose second type is the most
+//   derived. Handlers that cannot be ordered, for example of two unrelated bases of a type, keep the first one added.
+//   A handler added for the same pair replaces the previous one.
+// * Pairs without a handler return a default constructed R, add a handler of (BaseA, BaseB) to handle them instead.
+// * The table is built from the registered types, this must happen after static initialization. Update adds the types
+//   registered since, for example from a dynamically loaded library. Update and Add only resolve the cells they change.
+// * Update and Add are not thread safe, Dispatch can be called from several threads.
+
+/*Usage :
+
+bool HandleCollision(Ship* aShip, Asteroid* anAsteroid);
+bool HandleCollision(Ship* aShip, Ship* anOtherShip);
+
+KCL::RTTI::Dispatcher2<Entity, Entity, bool> dispatcher;
+dispatcher.Add<static_cast<bool (*)(Ship*, Asteroid*)>(&HandleCollision)>();
+dispatcher.Add<static_cast<bool (*)(Ship*, Ship*)>(&HandleCollision)>();
+
+bool destroyed = dispatcher.Dispatch(entity, otherEntity);
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+template<typename BaseA, typename BaseB, typename R>
+class Dispatcher2
+{
+public:
+	Dispatcher2()
+		: myColumnCapacity(0)
+		, myRegistrationHead(nullptr)
+	{
+		Update();
+	}
+
+	// aHandler is a function R(TypeA*, TypeB*), TypeA deriving from BaseA and TypeB from BaseB
+	template<auto aHandler>
+	void Add()
+	{
+		AddHandler<aHandler>(aHandler);
+	}
+
+	// Adds the types registered since the previous update
+	void Update()
+	{
+		using namespace KCL::RTTI_Private;
+
+		const TypeRegistration* head = GetTypeRegistrationHead().load(std::memory_order_acquire);
+		const uint32_t firstRow = (uint32_t)myRowTypes.size();
+		const uint32_t firstColumn = (uint32_t)myColumnTypes.size();
+		for (const TypeRegistration* it = head; it != myRegistrationHead; it = it->myNext)
+		{
+			const TypeInfo* typeInfo = it->myGetTypeInfo();
+			if (IsA(typeInfo, GetTypeInfo<BaseA>()))
+			{
+				myRowIndex.Add(typeInfo->GetTypeId(), (uint32_t)myRowTypes.size());
+				myRowTypes.push_back(typeInfo);
+				myRowBaseOffsets.push_back(ComputeBaseOffset(typeInfo, GetTypeId<BaseA>()));
+			}
+			if (IsA(typeInfo, GetTypeInfo<BaseB>()))
+			{
+				myColumnIndex.Add(typeInfo->GetTypeId(), (uint32_t)myColumnTypes.size());
+				myColumnTypes.push_back(typeInfo);
+				myColumnBaseOffsets.push_back(ComputeBaseOffset(typeInfo, GetTypeId<BaseB>()));
+			}
+		}
+		myRegistrationHead = head;
+
+		// Columns are allocated ahead so that new ones do not move the rows every time
+		if (myColumnTypes.size() > myColumnCapacity)
+		{
+			const size_t columnCapacity = std::max<size_t>(myColumnTypes.size(), myColumnCapacity * 2);
+			std::vector<Cell> cells(myRowTypes.size() * columnCapacity, Cell{&NoHandler, 0, 0});
+			std::vector<uint32_t> cellHandlers(cells.size(), theNoHandlerIndex);
+			for (size_t row = 0; row < firstRow; ++row)
+			{
+				std::copy_n(&myCells[row * myColumnCapacity], firstColumn, &cells[row * columnCapacity]);
+				std::copy_n(&myCellHandlers[row * myColumnCapacity], firstColumn, &cellHandlers[row * columnCapacity]);
+			}
+			myCells.swap(cells);
+			myCellHandlers.swap(cellHandlers);
+			myColumnCapacity = columnCapacity;
+		}
+		else
+		{
+			myCells.resize(myRowTypes.size() * myColumnCapacity, Cell{&NoHandler, 0, 0});
+			myCellHandlers.resize(myCells.size(), theNoHandlerIndex);
+		}
+
+		const uint32_t handlerCount = (uint32_t)myHandlers.size();
+		Resolve(firstRow, (uint32_t)myRowTypes.size(), 0, (uint32_t)myColumnTypes.size(), 0, handlerCount);
+		Resolve(0, firstRow, firstColumn, (uint32_t)myColumnTypes.size(), 0, handlerCount);
+	}
+
+	// Calls the most specific handler of the dynamic types of the objects, both must not be null
+	KCL_FORCEINLINE R Dispatch(BaseA* aFirst, BaseB* aSecond) const
+	{
+		assert(aFirst && aSecond);
+		const uint32_t* row = myRowIndex.Find(aFirst->KCL_RTTI_GetTypeId());
+		const uint32_t* column = myColumnIndex.Find(aSecond->KCL_RTTI_GetTypeId());
+		// Types registered after the last update are not in the table
+		if (!row || !column)
+			return R();
+
+		const Cell& cell = myCells[(size_t)*row * myColumnCapacity + *column];
+		return cell.myHandler(aFirst, aSecond, cell.myFirstOffset, cell.mySecondOffset);
+	}
+
+	KCL_FORCEINLINE size_t GetRowCount() const { return myRowTypes.size(); }
+	KCL_FORCEINLINE size_t GetColumnCount() const { return myColumnTypes.size(); }
+
+	// Memory used by the table and the indices, not the data used to update them
+	KCL_FORCEINLINE size_t GetByteSize() const
+	{
+		return myCells.size() * sizeof(Cell) + myRowIndex.GetByteSize() + myColumnIndex.GetByteSize();
+	}
+
+private:
+	// Takes the offsets from the bases to the types of the handler
+	typedef R (*HandlerFunc)(BaseA*, BaseB*, int32_t, int32_t);
+
+	struct Cell
+	{
+		HandlerFunc myHandler;
+		int32_t myFirstOffset;
+		int32_t mySecondOffset;
+	};
+
+	struct Handler
+	{
+		const TypeInfo* myFirstType;
+		const TypeInfo* mySecondType;
+		HandlerFunc myFunction;
+	};
+
+	static constexpr uint32_t theNoHandlerIndex = UINT32_MAX;
+
+	template<auto aHandler, typename TypeA, typename TypeB>
+	void AddHandler(R (*)(TypeA*, TypeB*))
+	{
+		static_assert(std::is_base_of<BaseA, TypeA>::value && std::is_base_of<BaseB, TypeB>::value,
+					  "Handler arguments must derive from the bases of the dispatcher");
+
+		myHandlers.push_back(Handler{GetTypeInfo<TypeA>(), GetTypeInfo<TypeB>(), &Invoke<aHandler, TypeA, TypeB>});
+		const uint32_t handler = (uint32_t)myHandlers.size() - 1;
+		Resolve(0, (uint32_t)myRowTypes.size(), 0, (uint32_t)myColumnTypes.size(), handler, handler + 1);
+	}
+
+	template<auto aHandler, typename TypeA, typename TypeB>
+	static R Invoke(BaseA* aFirst, BaseB* aSecond, int32_t aFirstOffset, int32_t aSecondOffset)
+	{
+		using namespace KCL::RTTI_Private;
+		return aHandler(AdjustArgument<TypeA>(aFirst, aFirstOffset), AdjustArgument<TypeB>(aSecond, aSecondOffset));
+	}
+
+	static R NoHandler(BaseA*, BaseB*, int32_t, int32_t) { return R(); }
+
+	bool IsMoreSpecific(const Handler& aHandler, const Handler& anOtherHandler) const
+	{
+		using namespace KCL::RTTI_Private;
+
+		if (aHandler.myFirstType != anOtherHandler.myFirstType)
+			return IsA(aHandler.myFirstType, anOtherHandler.myFirstType);
+		return aHandler.mySecondType == anOtherHandler.mySecondType || IsA(aHandler.mySecondType, anOtherHandler.mySecondType);
+	}
+
+	// Offers the handlers in order to the cells of the given rows and columns, replaying the order they were added in
+	void Resolve(uint32_t aFirstRow, uint32_t anEndRow, uint32_t aFirstColumn, uint32_t anEndColumn, uint32_t aFirstHandler,
+				 uint32_t anEndHandler)
+	{
+		using namespace KCL::RTTI_Private;
+
+		if (aFirstRow == anEndRow || aFirstColumn == anEndColumn)
+			return;
+
+		std::vector<uint32_t> columns;
+		for (uint32_t handlerIndex = aFirstHandler; handlerIndex < anEndHandler; ++handlerIndex)
+		{
+			const Handler& handler = myHandlers[handlerIndex];
+			columns.clear();
+			for (uint32_t column = aFirstColumn; column < anEndColumn; ++column)
+				if (IsA(myColumnTypes[column], handler.mySecondType))
+					columns.push_back(column);
+
+			for (uint32_t row = aFirstRow; row < anEndRow; ++row)
+			{
+				if (columns.empty() || !IsA(myRowTypes[row], handler.myFirstType))
+					continue;
+
+				const int32_t firstOffset = ComputeArgumentOffset(myRowTypes[row], myRowBaseOffsets[row], handler.myFirstType);
+				for (uint32_t column : columns)
+				{
+					const size_t cellIndex = (size_t)row * myColumnCapacity + column;
+					uint32_t& cellHandler = myCellHandlers[cellIndex];
+					if (cellHandler != theNoHandlerIndex && !IsMoreSpecific(handler, myHandlers[cellHandler]))
+						continue;
+
+					cellHandler = handlerIndex;
+					myCells[cellIndex] = Cell{handler.myFunction, firstOffset,
+						ComputeArgumentOffset(myColumnTypes[column], myColumnBaseOffsets[column], handler.mySecondType)};
+				}
+			}
+		}
+	}
+
+	// Read by Dispatch
+	TypeMap<uint32_t> myRowIndex;
+	TypeMap<uint32_t> myColumnIndex;
+	std::vector<Cell> myCells;
+	size_t myColumnCapacity;
+
+	std::vector<const TypeInfo*> myRowTypes;
+	std::vector<const TypeInfo*> myColumnTypes;
+	std::vector<int32_t> myRowBaseOffsets;
+	std::vector<int32_t> myColumnBaseOffsets;
+	std::vector<Handler> myHandlers;
+	// Index of the handler of each cell, to compare it with handlers added later
+	std::vector<uint32_t> myCellHandlers;
+	// Types after this one in the registration list are in the table
+	const KCL::RTTI_Private::TypeRegistration* myRegistrationHead;
+};
+
+} // namespace RTTI
+} // namespace KCL
@@ -0,0 +1,260 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Registry.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Event bus delivering each event to the subscribers of its type and of all its bases.
+// Subscribers are grouped by the type they subscribed to. The first time a type of event is published, the bus walks the
+// bases of the type in its type data, gathers their subscribers, and stores them in a list for the type along with the
+// offset from the event to the type each subscriber expects. Publishing then walks a single contiguous array, without
+// casts or map lookups.
+// Note:
+// * Events are registered polymorphic types. A base present several times in an event type is delivered once, as the
+//   first subobject found.
+// * Subscribers are called in the order they subscribed. Subscribing or unsubscribing invalidates the lists of the event
+//   types deriving from the type only, they are rebuilt on their next publish.
+// * Subscribing or unsubscribing while an event is published is not supported, publishing from a subscriber is.
+// * Buses are not thread safe, use one per thread.
+
+/*Usage :
+
+KCL::RTTI::TypeEventBus bus;
+KCL::RTTI::EventSubscription subscription = bus.Subscribe<DamageEvent>([](const DamageEvent& anEvent) { ... });
+
+bus.Publish(CriticalDamageEvent(target, 100)); // Received by the DamageEvent subscribers
+
+bus.Unsubscribe(subscription);
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+struct EventSubscription
+{
+	typeId_t myTypeId;
+	// 0 for an empty subscription
+	uint64_t mySerial;
+};
+
+class TypeEventBus
+{
+public:
+	TypeEventBus()
+		: myNextSerial(1)
+		, myPublishDepth(0)
+	{
+	}
+
+	TypeEventBus(const TypeEventBus&) = delete;
+	TypeEventBus& operator=(const TypeEventBus&) = delete;
+
+	~TypeEventBus() { assert(myPublishDepth == 0); }
+
+	// aFunction(const T&) is called for the events of type T and of the types deriving from T
+	template<typename T, typename Function>
+	EventSubscription Subscribe(Function aFunction)
+	{
+		assert(myPublishDepth == 0 && "Subscribing while an event is published");
+
+		const TypeInfo* typeInfo = GetTypeInfo<T>();
+		SubscriberBucket& bucket = mySubscribers.FindOrAdd(typeInfo->GetTypeId());
+		bucket.myTypeInfo = typeInfo;
+
+		// Serials increase, buckets stay sorted by serial
+		const uint64_t serial = myNextSerial++;
+		ContextPtr context(new Function(std::move(aFunction)), &DeleteContext<Function>);
+		bucket.mySubscribers.push_back(Subscriber{serial, &Invoke<T, Function>, std::move(context)});
+
+		Invalidate(typeInfo);
+		return EventSubscription{typeInfo->GetTypeId(), serial};
+	}
+
+	// Returns false if the subscription is empty or was already removed
+	bool Unsubscribe(EventSubscription& aSubscription)
+	{
+		assert(myPublishDepth == 0 && "Unsubscribing while an event is published");
+
+		SubscriberBucket* bucket = mySubscribers.Find(aSubscription.myTypeId);
+		if (aSubscription.mySerial == 0 || !bucket)
+			return false;
+
+		auto it = std::lower_bound(bucket->mySubscribers.begin(), bucket->mySubscribers.end(), aSubscription.mySerial,
+								   [](const Subscriber& aSubscriber, uint64_t aSerial) { return aSubscriber.mySerial < aSerial; });
+		if (it == bucket->mySubscribers.end() || it->mySerial != aSubscription.mySerial)
+			return false;
+
+		bucket->mySubscribers.erase(it);
+		Invalidate(bucket->myTypeInfo);
+		aSubscription.mySerial = 0;
+		return true;
+	}
+
+	// Calls the subscribers of the dynamic type of the event and of its bases
+	template<typename T>
+	void Publish(const T& anEvent)
+	{
+		const TypeInfo* typeInfo = anEvent.KCL_RTTI_GetTypeInfo();
+
+		// Events are usually published with their own type, which is the most derived object.
+		// Otherwise T may be present several times in the type, only the object knows which subobject it is.
+		intptr_t event = (intptr_t)&anEvent;
+		if (typeInfo->GetTypeId() != GetTypeId<T>())
+			event = anEvent.KCL_RTTI_DynamicCast(typeInfo->GetTypeId(), typeInfo->GetDepth());
+
+		// Lists are moved but not reallocated by lists built while publishing, the array stays valid
+		const std::vector<Handler>& handlers = GetList(typeInfo).myHandlers;
+		const Handler* handler = handlers.data();
+		const Handler* end = handler + handlers.size();
+
+		++myPublishDepth;
+		for (; handler != end; ++handler)
+			handler->myFunction(handler->myContext, event + handler->myOffset);
+		--myPublishDepth;
+	}
+
+	// Subscribers that receive the events of the type, 0 if none was published since the last change
+	size_t GetHandlerCount(const TypeInfo* aTypeInfo) const
+	{
+		const HandlerList* list = myLists.Find(aTypeInfo->GetTypeId());
+		if (!list || !list->myIsValid)
+			return 0;
+		return list->myHandlers.size();
+	}
+
+private:
+	// Takes the subscriber and the event, as the type it subscribed to
+	typedef void (*HandlerFunc)(void*, intptr_t);
+	typedef std::unique_ptr<void, void (*)(void*)> ContextPtr;
+
+	struct Subscriber
+	{
+		uint64_t mySerial;
+		HandlerFunc myFunction;
+		ContextPtr myContext;
+	};
+
+	struct SubscriberBucket
+	{
+		const TypeInfo* myTypeInfo;
+		// Sorted by serial
+		std::vector<Subscriber> mySubscribers;
+	};
+
+	struct Handler
+	{
+		HandlerFunc myFunction;
+		void* myContext;
+		intptr_t myOffset;
+	};
+
+	// Handlers of an event type and its bases, in subscription order
+	struct HandlerList
+	{
+		const TypeInfo* myTypeInfo;
+		std::vector<Handler> myHandlers;
+		bool myIsValid;
+	};
+
+	template<typename T, typename Function>
+	static void Invoke(void* aContext, intptr_t anEvent)
+	{
+		(*static_cast<Function*>(aContext))(*reinterpret_cast<const T*>(anEvent));
+	}
+
+	template<typename Function>
+	static void DeleteContext(void* aContext)
+	{
+		delete static_cast<Function*>(aContext);
+	}
+
+	KCL_FORCEINLINE const HandlerList& GetList(const TypeInfo* aTypeInfo)
+	{
+		const HandlerList* list = myLists.Find(aTypeInfo->GetTypeId());
+		if (!list || !list->myIsValid)
+			return BuildList(aTypeInfo);
+		return *list;
+	}
+
+	KCL_NOINLINE HandlerList& BuildList(const TypeInfo* aTypeInfo)
+	{
+		// The type and all its bases, each once
+		std::vector<typeId_t> typeIds;
+		for (const typeId_t* block = aTypeInfo->GetTypeData(); *block != 0; block += *block + 1)
+			typeIds.insert(typeIds.end(), block + 1, block + 1 + *block);
+		std::sort(typeIds.begin(), typeIds.end());
+		typeIds.erase(std::unique(typeIds.begin(), typeIds.end()), typeIds.end());
+
+		typedef std::pair<uint64_t, Handler> SerialHandler;
+		std::vector<SerialHandler> handlers;
+		for (typeId_t typeId : typeIds)
+		{
+			const SubscriberBucket* bucket = mySubscribers.Find(typeId);
+			if (!bucket || bucket->mySubscribers.empty())
+				continue;
+
+			// Offset from the most derived object
+			const intptr_t offset = KCL::RTTI_Private::GetBaseOffset(aTypeInfo, typeId);
+			for (const Subscriber& subscriber : bucket->mySubscribers)
+				handlers.emplace_back(subscriber.mySerial, Handler{subscriber.myFunction, subscriber.myContext.get(), offset});
+		}
+		std::sort(handlers.begin(), handlers.end(),
+				  [](const SerialHandler& aLeft, const SerialHandler& aRight) { return aLeft.first < aRight.first; });
+
+		HandlerList& list = myLists.FindOrAdd(aTypeInfo->GetTypeId());
+		list.myTypeInfo = aTypeInfo;
+		list.myHandlers.clear();
+		for (const auto& it : handlers)
+			list.myHandlers.push_back(it.second);
+		list.myIsValid = true;
+		return list;
+	}
+
+	// Lists of the event types deriving from the type are rebuilt on their next publish
+	void Invalidate(const TypeInfo* aTypeInfo)
+	{
+		myLists.ForEach([aTypeInfo](typeId_t, HandlerList& aList) {
+			const intptr_t offset = KCL::RTTI_Private::GetBaseOffset(aList.myTypeInfo, aTypeInfo->GetTypeId());
+			if (aList.myIsValid && offset != KCL::RTTI_Private::theNotABaseOffset)
+				aList.myIsValid = false;
+		});
+	}
+
+	TypeMap<HandlerList> myLists;
+	TypeMap<SubscriberBucket> mySubscribers;
+	uint64_t myNextSerial;
+	uint32_t myPublishDepth;
+};
+} // namespace RTTI
+} // namespace KCL
@@ -0,0 +1,261 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Registry.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Creation of registered types from their type id or name, each type allocating from its own pool.
+// A pool hands out fixed size slots carved from chunks of growing size, freed slots are kept in a free list and reused
+// first, while they are still in cache. Nothing is returned to the system before the pool is destroyed.
+// Pools count their live objects and the most objects alive at once, the high-water mark, to size them up front.
+// Note:
+// * Types are created with their default constructor, see ObjectTraits. Types that are not default constructible or
+//   abstract are not created.
+// * Objects must be destroyed through the factory that created them, before it is destroyed.
+// * Factories and pools are not thread safe, use one per thread.
+
+/*Usage :
+
+KCL::RTTI::ObjectFactory factory;
+Projectile* projectile = factory.Create<Projectile>(spawnData.myTypeId);
+Entity* entity = factory.Create<Entity>("Monster");
+
+factory.Destroy(projectile);
+
+factory.ForEachPool([](const KCL::RTTI::TypePool& aPool) {
+	printf("%s: %zu\n", aPool.GetTypeInfo()->GetName(), aPool.GetHighWaterMark());
+});
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+class TypePool
+{
+public:
+	explicit TypePool(const TypeInfo* aTypeInfo, size_t aFirstChunkCount = theDefaultFirstChunkCount)
+		: myTypeInfo(aTypeInfo)
+		, myTraits(aTypeInfo->GetObjectTraits())
+		, myFreeList(nullptr)
+		, myNextChunkCount(std::max<size_t>(aFirstChunkCount, 1))
+		, myCapacity(0)
+		, myLiveCount(0)
+		, myHighWaterMark(0)
+	{
+		// Free slots hold the next free slot
+		const size_t alignment = std::max<size_t>(myTraits.myAlignment, alignof(FreeSlot));
+		mySlotSize = (std::max<size_t>(myTraits.mySize, sizeof(FreeSlot)) + alignment - 1) & ~(alignment - 1);
+		mySlotAlignment = alignment;
+	}
+
+	~TypePool() { assert(myLiveCount == 0 && "Objects of the pool were not destroyed"); }
+
+	TypePool(const TypePool&) = delete;
+	TypePool& operator=(const TypePool&) = delete;
+
+	// Memory for an object, the object is not constructed
+	KCL_FORCEINLINE void* Allocate()
+	{
+		if (!myFreeList)
+			Grow();
+
+		FreeSlot* slot = myFreeList;
+		myFreeList = slot->myNext;
+		myHighWaterMark = std::max(myHighWaterMark, ++myLiveCount);
+		return slot;
+	}
+
+	KCL_FORCEINLINE void Deallocate(void* aMemory)
+	{
+		FreeSlot* slot = static_cast<FreeSlot*>(aMemory);
+		slot->myNext = myFreeList;
+		myFreeList = slot;
+		--myLiveCount;
+	}
+
+	// Default constructed object of the type of the pool, nullptr if the type is not default constructible
+	KCL_FORCEINLINE void* Create()
+	{
+		if (!myTraits.myConstruct)
+			return nullptr;
+		return myTraits.myConstruct(Allocate());
+	}
+
+	// anObject is the most derived object
+	KCL_FORCEINLINE void Destroy(void* anObject)
+	{
+		myTraits.myDestruct(anObject);
+		Deallocate(anObject);
+	}
+
+	KCL_FORCEINLINE const TypeInfo* GetTypeInfo() const { return myTypeInfo; }
+	KCL_FORCEINLINE size_t GetLiveCount() const { return myLiveCount; }
+	// Most objects alive at once since the pool was created or the mark was reset
+	KCL_FORCEINLINE size_t GetHighWaterMark() const { return myHighWaterMark; }
+	// Lowers the mark to the current live count, for example to measure each frame apart
+	KCL_FORCEINLINE void ResetHighWaterMark() { myHighWaterMark = myLiveCount; }
+	// Number of slots allocated
+	KCL_FORCEINLINE size_t GetCapacity() const { return myCapacity; }
+	KCL_FORCEINLINE size_t GetByteSize() const { return myCapacity * mySlotSize; }
+
+	// Allocates the chunks needed to hold aCount objects without growing
+	void Reserve(size_t aCount)
+	{
+		if (aCount > myCapacity)
+		{
+			myNextChunkCount = std::max(myNextChunkCount, aCount - myCapacity);
+			Grow();
+		}
+	}
+
+private:
+	static constexpr size_t theDefaultFirstChunkCount = 64;
+
+	struct FreeSlot
+	{
+		FreeSlot* myNext;
+	};
+
+	// Each chunk is as large as all the previous ones, the number of chunks grows with the log of the capacity
+	void Grow()
+	{
+		const size_t count = myNextChunkCount;
+		std::unique_ptr<uint8_t[]> chunk(new uint8_t[count * mySlotSize + mySlotAlignment]);
+		uint8_t* slots = chunk.get() + (-(intptr_t)chunk.get() & (intptr_t)(mySlotAlignment - 1));
+		myChunks.push_back(std::move(chunk));
+
+		// Slots are handed out in address order
+		for (size_t i = count; i-- > 0;)
+		{
+			FreeSlot* slot = reinterpret_cast<FreeSlot*>(slots + i * mySlotSize);
+			slot->myNext = myFreeList;
+			myFreeList = slot;
+		}
+
+		myCapacity += count;
+		myNextChunkCount = myCapacity;
+	}
+
+	const TypeInfo* myTypeInfo;
+	const ObjectTraits& myTraits;
+	FreeSlot* myFreeList;
+	size_t mySlotSize;
+	size_t mySlotAlignment;
+	size_t myNextChunkCount;
+	size_t myCapacity;
+	size_t myLiveCount;
+	size_t myHighWaterMark;
+	std::vector<std::unique_ptr<uint8_t[]>> myChunks;
+};
+
+class ObjectFactory
+{
+public:
+	ObjectFactory() = default;
+
+	ObjectFactory(const ObjectFactory&) = delete;
+	ObjectFactory& operator=(const ObjectFactory&) = delete;
+
+	// Returns the most derived object, nullptr if the type is not default constructible
+	KCL_FORCEINLINE void* Create(const TypeInfo* aTypeInfo) { return GetPool(aTypeInfo).Create(); }
+
+	// nullptr if the type is unknown, not default constructible or not a T
+	template<typename T>
+	T* Create(const TypeInfo* aTypeInfo)
+	{
+		if (!aTypeInfo)
+			return nullptr;
+
+		// The offset of T is checked before creating anything
+		const intptr_t offset = RTTI_Private::GetBaseOffset(aTypeInfo, GetTypeId<T>(), GetTypeDepth<T>());
+		if (offset == RTTI_Private::theNotABaseOffset)
+			return nullptr;
+
+		void* object = Create(aTypeInfo);
+		return object ? reinterpret_cast<T*>((intptr_t)object + offset) : nullptr;
+	}
+
+	template<typename T>
+	KCL_FORCEINLINE T* Create(typeId_t aTypeId)
+	{
+		return Create<T>(TypeRegistry::GetInstance().FindById(aTypeId));
+	}
+
+	template<typename T>
+	KCL_FORCEINLINE T* Create(const char* aName)
+	{
+		return Create<T>(TypeRegistry::GetInstance().FindByName(aName));
+	}
+
+	// Destroys an object of a polymorphic type created by this factory, through any of its bases
+	template<typename T>
+	void Destroy(T* anObject)
+	{
+		const TypeInfo* typeInfo = nullptr;
+		const intptr_t object = GetMostDerived(anObject, typeInfo);
+		if (object)
+			GetPool(typeInfo).Destroy(reinterpret_cast<void*>(object));
+	}
+
+	// anObject is the most derived object
+	KCL_FORCEINLINE void Destroy(const TypeInfo* aTypeInfo, void* anObject) { GetPool(aTypeInfo).Destroy(anObject); }
+
+	// Pool of the type, created on first use
+	KCL_FORCEINLINE TypePool& GetPool(const TypeInfo* aTypeInfo)
+	{
+		if (std::unique_ptr<TypePool>* pool = myPools.Find(aTypeInfo->GetTypeId()))
+			return **pool;
+		return AddPool(aTypeInfo);
+	}
+
+	// aFunction(const TypePool&) is called for each pool, in no particular order
+	template<typename Function>
+	void ForEachPool(Function aFunction) const
+	{
+		myPools.ForEach(
+			[&aFunction](typeId_t, const std::unique_ptr<TypePool>& aPool) { aFunction(static_cast<const TypePool&>(*aPool)); });
+	}
+
+private:
+	KCL_NOINLINE TypePool& AddPool(const TypeInfo* aTypeInfo)
+	{
+		std::unique_ptr<TypePool>& pool = myPools.FindOrAdd(aTypeInfo->GetTypeId());
+		pool.reset(new TypePool(aTypeInfo));
+		return *pool;
+	}
+
+	// Pools are allocated on their own, growing the map moves the pointers only
+	TypeMap<std::unique_ptr<TypePool>> myPools;
+};
+} // namespace RTTI
+} // namespace KCL
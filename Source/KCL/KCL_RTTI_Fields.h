@@ -0,0 +1,204 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "KCL_RTTI.h"
+
+// Field reflection, records the name, offset, size and type of the listed members of a type.
+// The fields are an array referenced by the type info, see TypeInfo::GetFields. No compiler RTTI or exception is used.
+// Note:
+// * The type must be registered with KCL_RTTI_REGISTER, in any order with KCL_RTTI_FIELDS. Fields of bases are listed
+//   with the derived type, offsets are from the start of the type that lists them.
+// * The fields must be accessible from the KCL::RTTI_Private namespace, either public or with
+//   friend struct KCL::RTTI_Private::FieldsDeclaration<Type>;
+// * Like the offsets of the bases, offsets are computed during static initialization.
+// * Up to 63 fields, bit fields and references are not supported.
+// * Each field has a kind deduced from its type: trivially copyable values, registered types described by their own
+//   fields, and pointers to registered polymorphic types. Other types are Unsupported, still listed but not serializable.
+// * Pointers to unregistered types are Unsupported rather than Trivial, an address is meaningless once copied.
+
+/*Usage :
+
+struct Item
+{
+	KCL_RTTI_IMPL()
+	int myCount;
+	Transform myTransform;
+};
+KCL_RTTI_REGISTER(Item)
+KCL_RTTI_FIELDS(Item, myCount, myTransform)
+
+for (const KCL::RTTI::FieldInfo& field : KCL::RTTI::GetTypeInfo<Item>()->GetFields())
+	printf("%s at %u\n", field.myName, field.myOffset);
+
+*/
+
+namespace KCL
+{
+namespace RTTI_Private
+{
+// Specialized by KCL_RTTI_FIELDS
+template<typename T>
+struct FieldsDeclaration;
+
+// Accessor of the type info of a field, nullptr if the type of the field is not registered
+template<typename T, typename = void>
+struct FieldTypeInfo
+{
+	static constexpr bool ourIsRegistered = false;
+	static constexpr GetTypeInfoFunc ourGet = nullptr;
+};
+
+template<typename T>
+struct FieldTypeInfo<T, std::void_t<decltype(&GetTypeInfo<T>::Get)>>
+{
+	static constexpr bool ourIsRegistered = true;
+	static constexpr GetTypeInfoFunc ourGet = &GetTypeInfo<T>::Get;
+};
+
+template<typename T, typename = void>
+struct IsPolymorphicRegistered : std::false_type
+{
+};
+
+template<typename T>
+struct IsPolymorphicRegistered<T, std::void_t<decltype(std::declval<const T&>().KCL_RTTI_GetTypeInfo())>> : std::true_type
+{
+};
+
+// Address of the most derived object pointed to by a T* field
+template<typename T>
+intptr_t GetFieldPointee(const void* aField, const RTTI::TypeInfo*& aTypeInfoOut)
+{
+	return RTTI::GetMostDerived(*static_cast<T* const*>(aField), aTypeInfoOut);
+}
+
+template<typename T>
+constexpr RTTI::FieldKind GetValueFieldKind()
+{
+	if constexpr (std::is_trivially_copyable<T>::value)
+		return RTTI::FieldKind::Trivial;
+	else if constexpr (FieldTypeInfo<T>::ourIsRegistered)
+		return RTTI::FieldKind::Object;
+	else
+		return RTTI::FieldKind::Unsupported;
+}
+
+// Kind, type info and pointer accessor of a field of type T
+template<typename T, typename = void>
+struct FieldTraits
+{
+	static constexpr RTTI::FieldKind ourKind = GetValueFieldKind<T>();
+	static constexpr GetTypeInfoFunc ourGetTypeInfo = FieldTypeInfo<T>::ourGet;
+	static constexpr intptr_t (*ourGetPointee)(const void*, const RTTI::TypeInfo*&) = nullptr;
+};
+
+template<typename T>
+struct FieldTraits<T*, void>
+{
+	typedef std::remove_cv_t<T> PointeeType;
+	static constexpr bool ourIsPolymorphic = IsPolymorphicRegistered<PointeeType>::value;
+
+	static constexpr RTTI::FieldKind ourKind = ourIsPolymorphic ? RTTI::FieldKind::Pointer : RTTI::FieldKind::Unsupported;
+	static constexpr GetTypeInfoFunc ourGetTypeInfo = FieldTypeInfo<PointeeType>::ourGet;
+	static constexpr intptr_t (*ourGetPointee)(const void*, const RTTI::TypeInfo*&) =
+		ourIsPolymorphic ? &GetFieldPointee<PointeeType> : nullptr;
+};
+
+// Members of a base are reached through the conversion of the object pointer, the offset is from Owner
+template<typename Owner, typename Field, typename Class>
+uint32_t ComputeFieldOffset(Field Class::*aMember)
+{
+	// Any address works as no object is accessed, large enough not to be null once converted to a base
+	Owner* owner = reinterpret_cast<Owner*>(0x10000);
+	return (uint32_t)((intptr_t)&(owner->*aMember) - (intptr_t)owner);
+}
+
+// Sorts the fields by offset into someRunsOut, merging the trivial fields that follow each other without padding
+inline size_t ComputeFieldRuns(const RTTI::FieldInfo* someFields, size_t aCount, RTTI::FieldRun* someRunsOut)
+{
+	const RTTI::FieldInfo* sorted[64];
+	for (size_t i = 0; i < aCount; ++i)
+		sorted[i] = someFields + i;
+	std::stable_sort(sorted, sorted + aCount, [](const RTTI::FieldInfo* aLeft, const RTTI::FieldInfo* aRight) {
+		return aLeft->myOffset < aRight->myOffset;
+	});
+
+	size_t runCount = 0;
+	for (size_t i = 0; i < aCount; ++i)
+	{
+		const RTTI::FieldInfo* field = sorted[i];
+		const bool isTrivial = field->myKind == RTTI::FieldKind::Trivial;
+		RTTI::FieldRun* previous = runCount > 0 ? someRunsOut + runCount - 1 : nullptr;
+		if (isTrivial && previous && !previous->myField && previous->myOffset + previous->mySize == field->myOffset)
+			previous->mySize += field->mySize;
+		else
+			someRunsOut[runCount++] = RTTI::FieldRun{field->myOffset, field->mySize, isTrivial ? nullptr : field};
+	}
+	return runCount;
+}
+
+template<typename T>
+bool SetFields(const RTTI::FieldInfo* someFields, RTTI::FieldRun* someRuns, size_t aCount)
+{
+	const size_t runCount = ComputeFieldRuns(someFields, aCount, someRuns);
+	RTTI::FieldList& fields = TypeFields<T>::ourFields;
+	fields.myFields = someFields;
+	fields.myCount = aCount;
+	fields.myRuns = someRuns;
+	fields.myRunCount = runCount;
+	return true;
+}
+} // namespace RTTI_Private
+} // namespace KCL
+
+#define _KCL_RTTI_FIELD(NAME)                                                                                                              \
+	{#NAME, ComputeFieldOffset<FieldOwner>(&FieldOwner::NAME), (uint32_t)sizeof(FieldOwner::NAME),                                         \
+	 FieldTraits<std::remove_cv_t<decltype(FieldOwner::NAME)>>::ourGetTypeInfo,                                                            \
+	 FieldTraits<std::remove_cv_t<decltype(FieldOwner::NAME)>>::ourGetPointee,                                                             \
+	 FieldTraits<std::remove_cv_t<decltype(FieldOwner::NAME)>>::ourKind},
+
+// Use after the type declaration, lists the members to reflect
+#define KCL_RTTI_FIELDS(TYPE, ...)                                                                                                         \
+	namespace KCL                                                                                                                          \
+	{                                                                                                                                      \
+	namespace RTTI_Private                                                                                                                 \
+	{                                                                                                                                      \
+	template<>                                                                                                                             \
+	struct FieldsDeclaration<TYPE>                                                                                                         \
+	{                                                                                                                                      \
+		typedef TYPE FieldOwner;                                                                                                           \
+		static const RTTI::FieldInfo ourFields[KCL_VA_COUNT(__VA_ARGS__)];                                                                 \
+		static RTTI::FieldRun ourRuns[KCL_VA_COUNT(__VA_ARGS__)];                                                                          \
+		static const bool ourIsSet;                                                                                                        \
+	};                                                                                                                                     \
+	inline const RTTI::FieldInfo FieldsDeclaration<TYPE>::ourFields[KCL_VA_COUNT(__VA_ARGS__)] = {                                         \
+		KCL_FOREACH(_KCL_RTTI_FIELD, __VA_ARGS__)};                                                                                        \
+	inline RTTI::FieldRun FieldsDeclaration<TYPE>::ourRuns[KCL_VA_COUNT(__VA_ARGS__)] = {};                                                \
+	inline const bool FieldsDeclaration<TYPE>::ourIsSet = SetFields<TYPE>(ourFields, ourRuns, KCL_VA_COUNT(__VA_ARGS__));                  \
+	}                                                                                                                                      \
+	}
@@ -0,0 +1,189 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_DispatchOffsets.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Dispatch on the dynamic type of an object, through a table indexed by type id instead of a chain of casts.
+//
+// Match calls the arm taking the most specific type of the object among a list of lambdas, like a switch on its type.
+// The arm and the offset of its argument are found in a table per base and list of arm types, built the first time it
+// is used, so the cost does not depend on the number of arms.
+// Note:
+// * Arms take a single reference to a registered type, the object may be cast to a type that is not a base of the
+//   pointer. Arms that cannot be ordered, for example of two unrelated bases of the type, keep the first one listed.
+// * Nothing is called for a null pointer or an object matching no arm, a default constructed value is returned.
+// * Types registered after the table is built, for example from a dynamically loaded library, choose their arm on every
+//   call, walking the arms.
+
+/*Usage :
+
+float speed = KCL::RTTI::Match(entity,
+	[](Ship& aShip) { return aShip.GetSpeed(); },
+	[](Asteroid& anAsteroid) { return anAsteroid.GetVelocity().Length(); },
+	[](Entity&) { return 0.f; });
+
+*/
+
+namespace KCL
+{
+namespace RTTI_Private
+{
+// Type of the argument and result of an arm of Match, lambdas and functions taking a single reference
+template<typename Function>
+struct MatchArmTraits : MatchArmTraits<decltype(&Function::operator())>
+{
+};
+
+template<typename Result, typename Argument>
+struct MatchArmTraits<Result (*)(Argument)>
+{
+	static_assert(std::is_reference<Argument>::value, "Arms take the object by reference");
+	typedef typename std::remove_reference<Argument>::type Type;
+	typedef Result ResultType;
+};
+
+template<typename Class, typename Result, typename Argument>
+struct MatchArmTraits<Result (Class::*)(Argument) const> : MatchArmTraits<Result (*)(Argument)>
+{
+};
+
+template<typename Class, typename Result, typename Argument>
+struct MatchArmTraits<Result (Class::*)(Argument)> : MatchArmTraits<Result (*)(Argument)>
+{
+};
+
+static constexpr uint32_t theNoMatchArm = UINT32_MAX;
+
+struct MatchEntry
+{
+	uint32_t myArm;
+	int32_t myOffset;
+};
+
+// Arm of each registered type deriving from Base, shared by the matches of the same arm types
+template<typename Base, typename... ArmTypes>
+class MatchTable
+{
+public:
+	static const MatchTable& GetInstance()
+	{
+		static const MatchTable theInstance;
+		return theInstance;
+	}
+
+	KCL_FORCEINLINE MatchEntry Find(const Base* aBasePtr) const
+	{
+		const MatchEntry* entry = myEntries.Find(aBasePtr->KCL_RTTI_GetTypeId());
+		return entry ? *entry : ComputeEntry(aBasePtr->KCL_RTTI_GetTypeInfo());
+	}
+
+private:
+	MatchTable()
+	{
+		for (const TypeRegistration* it = GetTypeRegistrationHead().load(std::memory_order_acquire); it != nullptr; it = it->myNext)
+		{
+			const RTTI::TypeInfo* typeInfo = it->myGetTypeInfo();
+			if (IsA(typeInfo, RTTI::GetTypeInfo<Base>()))
+				myEntries.Add(typeInfo->GetTypeId(), ComputeEntry(typeInfo));
+		}
+	}
+
+	// The most derived arm type of the type, the first one listed when they cannot be ordered
+	KCL_NOINLINE static MatchEntry ComputeEntry(const RTTI::TypeInfo* aTypeInfo)
+	{
+		const RTTI::TypeInfo* const armTypes[] = {RTTI::GetTypeInfo<ArmTypes>()...};
+		uint32_t arm = theNoMatchArm;
+		for (uint32_t i = 0; i < sizeof...(ArmTypes); ++i)
+		{
+			if (IsA(aTypeInfo, armTypes[i]) && (arm == theNoMatchArm || (armTypes[i] != armTypes[arm] && IsA(armTypes[i], armTypes[arm]))))
+				arm = i;
+		}
+
+		if (arm == theNoMatchArm)
+			return MatchEntry{theNoMatchArm, 0};
+		return MatchEntry{arm, ComputeArgumentOffset(aTypeInfo, ComputeBaseOffset(aTypeInfo, RTTI::GetTypeId<Base>()), armTypes[arm])};
+	}
+
+	RTTI::TypeMap<MatchEntry> myEntries;
+};
+
+template<typename R, typename Base, typename ArmTuple, typename Indices>
+struct MatchInvokers;
+
+// One function per arm, the arm is selected with an indirect call whatever the number of arms
+template<typename R, typename Base, typename... Arms, size_t... Indices>
+struct MatchInvokers<R, Base, std::tuple<Arms...>, std::index_sequence<Indices...>>
+{
+	typedef R (*InvokeFunc)(std::tuple<Arms...>&, Base*, int32_t);
+
+	template<size_t Index>
+	static R Invoke(std::tuple<Arms...>& someArms, Base* aBasePtr, int32_t anOffset)
+	{
+		typedef typename std::decay<typename std::tuple_element<Index, std::tuple<Arms...>>::type>::type Arm;
+		return std::get<Index>(someArms)(*AdjustArgument<typename MatchArmTraits<Arm>::Type>(aBasePtr, anOffset));
+	}
+
+	static constexpr InvokeFunc ourInvokers[] = {&Invoke<Indices>...};
+};
+} // namespace RTTI_Private
+
+namespace RTTI
+{
+// Calls the arm taking the most specific type of the object, the result of the arm or a default constructed value if
+// no arm matches
+template<typename Base, typename... Arms>
+KCL_FORCEINLINE auto Match(Base* aBasePtr, Arms&&... someArms)
+{
+	using namespace KCL::RTTI_Private;
+	static_assert(sizeof...(Arms) > 0, "Match needs at least one arm");
+	static_assert(
+		!std::is_const<Base>::value || (std::is_const<typename MatchArmTraits<typename std::decay<Arms>::type>::Type>::value && ...),
+		"Arms of a const object take a const reference");
+
+	typedef typename std::common_type<typename MatchArmTraits<typename std::decay<Arms>::type>::ResultType...>::type R;
+	typedef MatchTable<typename std::remove_cv<Base>::type,
+		typename std::remove_cv<typename MatchArmTraits<typename std::decay<Arms>::type>::Type>::type...>
+		Table;
+	typedef MatchInvokers<R, Base, std::tuple<Arms&...>, std::index_sequence_for<Arms...>> Invokers;
+
+	if (!aBasePtr)
+		return R();
+
+	const MatchEntry entry = Table::GetInstance().Find(aBasePtr);
+	if (entry.myArm == theNoMatchArm)
+		return R();
+
+	std::tuple<Arms&...> arms(someArms...);
+	return Invokers::ourInvokers[entry.myArm](arms, aBasePtr, entry.myOffset);
+}
+} // namespace RTTI
+} // namespace KCL
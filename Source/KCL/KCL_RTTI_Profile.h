@@ -0,0 +1,160 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Registry.h"
+
+// Report of the casts recorded with KCL_RTTI_PROFILE, merged over all the threads.
+// Each record is a pair of dynamic type and target type, with the number of casts, how many succeeded, and the work they
+// did: the type ids compared and the secondary blocks walked. Their sum is the cost, records are sorted by decreasing
+// cost so that the casts worth caching or rewriting come first.
+// Note:
+// * Only casts walking the type data are recorded. Upcasts resolved at compile time and casts to final types, which are
+//   a single compare, are not.
+// * Reports can be built while other threads cast, the counts of these threads may be slightly behind.
+// * Without KCL_RTTI_PROFILE the report is always empty.
+
+/*Usage :
+
+// Build with KCL_RTTI_PROFILE=1
+RunGame();
+KCL::RTTI::PrintCastProfile(stdout, 20);
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+struct CastProfileRecord
+{
+	KCL_FORCEINLINE uint64_t GetCost() const { return myTypeIdCount + myBlockCount; }
+	KCL_FORCEINLINE double GetSuccessRate() const { return myCallCount ? (double)mySuccessCount / myCallCount : 0.0; }
+
+	typeId_t myTypeId;
+	typeId_t myTargetTypeId;
+	uint64_t myCallCount;
+	uint64_t mySuccessCount;
+	uint64_t myTypeIdCount;
+	uint64_t myBlockCount;
+};
+
+// Records of all the threads, sorted by decreasing cost
+inline std::vector<CastProfileRecord> GetCastProfile()
+{
+	std::vector<CastProfileRecord> records;
+#if KCL_RTTI_PROFILE
+	using namespace KCL::RTTI_Private;
+
+	const CastProfileTable* table = GetCastProfileHead().load(std::memory_order_acquire);
+	for (; table != nullptr; table = table->myNext)
+	{
+		for (const CastProfileEntry& entry : table->myEntries)
+		{
+			const uint64_t key = entry.myKey.load(std::memory_order_acquire);
+			if (key == 0)
+				continue;
+
+			CastProfileRecord record;
+			record.myTypeId = (typeId_t)(key >> 32);
+			record.myTargetTypeId = (typeId_t)key;
+			record.myCallCount = entry.myCallCount.load(std::memory_order_relaxed);
+			record.mySuccessCount = entry.mySuccessCount.load(std::memory_order_relaxed);
+			record.myTypeIdCount = entry.myTypeIdCount.load(std::memory_order_relaxed);
+			record.myBlockCount = entry.myBlockCount.load(std::memory_order_relaxed);
+			records.push_back(record);
+		}
+	}
+
+	// Merges the records of the same pair from several threads
+	auto isSamePair = [](const CastProfileRecord& aLeft, const CastProfileRecord& aRight) {
+		return aLeft.myTypeId == aRight.myTypeId && aLeft.myTargetTypeId == aRight.myTargetTypeId;
+	};
+	std::sort(records.begin(), records.end(), [](const CastProfileRecord& aLeft, const CastProfileRecord& aRight) {
+		return aLeft.myTypeId != aRight.myTypeId ? aLeft.myTypeId < aRight.myTypeId : aLeft.myTargetTypeId < aRight.myTargetTypeId;
+	});
+	size_t mergedCount = 0;
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		if (mergedCount > 0 && isSamePair(records[mergedCount - 1], records[i]))
+		{
+			CastProfileRecord& merged = records[mergedCount - 1];
+			merged.myCallCount += records[i].myCallCount;
+			merged.mySuccessCount += records[i].mySuccessCount;
+			merged.myTypeIdCount += records[i].myTypeIdCount;
+			merged.myBlockCount += records[i].myBlockCount;
+		}
+		else
+			records[mergedCount++] = records[i];
+	}
+	records.resize(mergedCount);
+
+	std::sort(records.begin(), records.end(),
+			  [](const CastProfileRecord& aLeft, const CastProfileRecord& aRight) { return aLeft.GetCost() > aRight.GetCost(); });
+#endif
+	return records;
+}
+
+// Casts which were not recorded because the table of their thread was full, see KCL_RTTI_PROFILE_CAPACITY
+inline uint64_t GetDroppedCastCount()
+{
+	uint64_t count = 0;
+#if KCL_RTTI_PROFILE
+	const KCL::RTTI_Private::CastProfileTable* table = KCL::RTTI_Private::GetCastProfileHead().load(std::memory_order_acquire);
+	for (; table != nullptr; table = table->myNext)
+		count += table->myDroppedCount.load(std::memory_order_relaxed);
+#endif
+	return count;
+}
+
+// Prints the aMaxCount most expensive records, type names are found in the registry
+inline void PrintCastProfile(FILE* aFile, size_t aMaxCount = SIZE_MAX)
+{
+	const std::vector<CastProfileRecord> records = GetCastProfile();
+	const TypeRegistry& registry = TypeRegistry::GetInstance();
+	auto getName = [&registry](typeId_t aTypeId) {
+		const TypeInfo* typeInfo = registry.FindById(aTypeId);
+		return typeInfo ? typeInfo->GetName() : "?";
+	};
+
+	fprintf(aFile, "%-24s %-24s %12s %8s %14s %12s %14s\n", "Type", "Target", "Calls", "Success", "Ids compared", "Blocks", "Cost");
+	for (size_t i = 0; i < records.size() && i < aMaxCount; ++i)
+	{
+		const CastProfileRecord& record = records[i];
+		fprintf(aFile, "%-24s %-24s %12llu %7.1f%% %14llu %12llu %14llu\n", getName(record.myTypeId),
+				getName(record.myTargetTypeId), (unsigned long long)record.myCallCount, record.GetSuccessRate() * 100,
+				(unsigned long long)record.myTypeIdCount, (unsigned long long)record.myBlockCount,
+				(unsigned long long)record.GetCost());
+	}
+
+	if (const uint64_t droppedCount = GetDroppedCastCount())
+		fprintf(aFile, "%llu casts were not recorded, increase KCL_RTTI_PROFILE_CAPACITY\n", (unsigned long long)droppedCount);
+}
+} // namespace RTTI
+} // namespace KCL
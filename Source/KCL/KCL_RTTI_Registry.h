@@ -0,0 +1,303 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "KCL_RTTI.h"
+
+// Registry of all the types registered with KCL_RTTI_REGISTER.
+// Types can be enumerated in type id order, and found by id or by name.
+// Name lookup uses a minimal perfect hash built with the hash and displace method: names are hashed once, the hash
+// selects a bucket, and the bucket stores the displacement that maps all of its names to distinct slots. A lookup is one
+// string hash, two table reads and a single name comparison, whatever the number of types.
+// Note:
+// * The registry is built the first time it is accessed, this must happen after static initialization.
+// * Types registered after the registry is built, for example from a dynamically loaded library, are not supported and
+//   stop the program, as do several types registered with the same name.
+
+/*Usage :
+
+const KCL::RTTI::TypeRegistry& registry = KCL::RTTI::TypeRegistry::GetInstance();
+
+for (const KCL::RTTI::TypeInfo* typeInfo : registry)
+	printf("%s\n", typeInfo->GetName());
+
+const KCL::RTTI::TypeInfo* typeInfo = registry.FindByName("Namespace::Type");
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+class TypeRegistry
+{
+public:
+	static const TypeRegistry& GetInstance()
+	{
+		static const TypeRegistry theInstance;
+		// They would be missing from the registry, and from the tables built from it
+		if (theInstance.myRegistrationHead != KCL::RTTI_Private::GetTypeRegistrationHead().load(std::memory_order_acquire))
+			KCL::RTTI_Private::RegistrationError("Types were registered after the registry was built");
+		return theInstance;
+	}
+
+	KCL_FORCEINLINE size_t GetTypeCount() const { return myTypes.size(); }
+
+	// Types sorted by type id
+	KCL_FORCEINLINE const TypeInfo* const* begin() const { return myTypes.data(); }
+	KCL_FORCEINLINE const TypeInfo* const* end() const { return myTypes.data() + myTypes.size(); }
+	KCL_FORCEINLINE const TypeInfo* operator[](size_t anIndex) const { return myTypes[anIndex]; }
+
+	const TypeInfo* FindById(typeId_t aTypeId) const
+	{
+#if !KCL_RTTI_HASHED_TYPEID
+		// Counter ids are dense, starting at 1
+		return (size_t)(aTypeId - 1) < myTypes.size() ? myTypes[aTypeId - 1] : nullptr;
+#else
+		auto it = std::lower_bound(myTypes.begin(), myTypes.end(), aTypeId,
+								   [](const TypeInfo* aTypeInfo, typeId_t anId) { return aTypeInfo->GetTypeId() < anId; });
+		return (it != myTypes.end() && (*it)->GetTypeId() == aTypeId) ? *it : nullptr;
+#endif
+	}
+
+	// Returns nullptr if no type is registered with this name. The name does not need to be null terminated.
+	const TypeInfo* FindByName(const char* aName, size_t aLength) const
+	{
+		if (mySlots.empty())
+			return nullptr;
+
+		const uint64_t hash = HashName(aName, aLength);
+		const Slot& slot = mySlots[GetSlotIndex(hash, myBucketDisplacements[GetBucketIndex(hash)])];
+		if (slot.myHash != hash)
+			return nullptr;
+
+		const char* name = slot.myTypeInfo->GetName();
+		return (memcmp(name, aName, aLength) == 0 && name[aLength] == 0) ? slot.myTypeInfo : nullptr;
+	}
+
+	KCL_FORCEINLINE const TypeInfo* FindByName(const char* aName) const { return FindByName(aName, strlen(aName)); }
+
+	// Memory used by the type info of a type: the TypeInfo, the type data with its padding, and the offsets of the
+	// secondary bases. The name is not included. See KCL_RTTI_TYPEID_BITS and KCL_RTTI_OFFSET_BITS to reduce it.
+	static size_t GetTypeDataByteSize(const TypeInfo* aTypeInfo)
+	{
+		const typeId_t* data = aTypeInfo->GetTypeData();
+		size_t idCount = data[0] + 1;
+		size_t offsetCount = 0;
+		for (const typeId_t* block = data + idCount; *block != 0; block += *block + 1)
+		{
+			idCount += *block + 1;
+			++offsetCount;
+		}
+
+		// End marker and padding, the type info is aligned for its pointers. Offset arrays have at least one element.
+		idCount += 1 + KCL::RTTI_Private::theTypeDataPaddingSize;
+		const size_t infoSize = sizeof(TypeInfo) + idCount * sizeof(typeId_t);
+		const size_t alignedInfoSize = (infoSize + alignof(TypeInfo) - 1) / alignof(TypeInfo) * alignof(TypeInfo);
+		return alignedInfoSize + std::max(offsetCount, (size_t)1) * sizeof(typeOffset_t);
+	}
+
+	// Number of subobjects of the given type in a type, walking all the blocks of the type data.
+	// Casts to a type present more than once are ambiguous, the first one found is returned.
+	static size_t CountTypeId(const TypeInfo* aTypeInfo, typeId_t aTypeId)
+	{
+		size_t count = 0;
+		for (const typeId_t* block = aTypeInfo->GetTypeData(); *block != 0; block += *block + 1)
+		{
+			for (typeId_t i = 1; i <= *block; ++i)
+				count += block[i] == aTypeId;
+		}
+		return count;
+	}
+
+	// Memory used by the type info of all the registered types
+	size_t GetTotalTypeDataByteSize() const
+	{
+		size_t byteSize = 0;
+		for (const TypeInfo* typeInfo : myTypes)
+			byteSize += GetTypeDataByteSize(typeInfo);
+		return byteSize;
+	}
+
+private:
+	struct Slot
+	{
+		uint64_t myHash;
+		const TypeInfo* myTypeInfo;
+	};
+
+	// Average number of names per bucket, higher values make the table smaller but longer to build
+	static constexpr size_t theBucketSize = 4;
+
+	TypeRegistry()
+	{
+		myRegistrationHead = KCL::RTTI_Private::GetTypeRegistrationHead().load(std::memory_order_acquire);
+		for (const KCL::RTTI_Private::TypeRegistration* it = myRegistrationHead; it != nullptr; it = it->myNext)
+			myTypes.push_back(it->myGetTypeInfo());
+
+		std::sort(myTypes.begin(), myTypes.end(),
+				  [](const TypeInfo* aLeft, const TypeInfo* aRight) { return aLeft->GetTypeId() < aRight->GetTypeId(); });
+
+#if KCL_RTTI_HASHED_TYPEID
+		// Types with the same hashed id are next to each other once sorted
+		for (size_t i = 1; i < myTypes.size(); ++i)
+		{
+			if (myTypes[i - 1]->GetTypeId() == myTypes[i]->GetTypeId())
+			{
+				fprintf(stderr, "KCL RTTI: %s and %s have the same hashed id\n", myTypes[i - 1]->GetName(), myTypes[i]->GetName());
+				KCL::RTTI_Private::RegistrationError("Type id collision, rename one of the types");
+			}
+		}
+#endif
+
+		BuildNameTable();
+	}
+
+	void BuildNameTable()
+	{
+		const size_t typeCount = myTypes.size();
+		if (typeCount == 0)
+			return;
+
+		myBucketDisplacements.resize((typeCount + theBucketSize - 1) / theBucketSize, 0);
+		mySlots.resize(typeCount, Slot{0, nullptr});
+
+		std::vector<std::vector<Slot>> buckets(myBucketDisplacements.size());
+		for (const TypeInfo* typeInfo : myTypes)
+		{
+			const uint64_t hash = HashName(typeInfo->GetName(), strlen(typeInfo->GetName()));
+			std::vector<Slot>& bucket = buckets[GetBucketIndex(hash)];
+
+			// Identical hashes cannot be separated by any seed
+			auto duplicate = std::find_if(bucket.begin(), bucket.end(), [hash](const Slot& aSlot) { return aSlot.myHash == hash; });
+			if (duplicate != bucket.end())
+			{
+				fprintf(stderr, "KCL RTTI: %s and %s have the same name hash\n", duplicate->myTypeInfo->GetName(), typeInfo->GetName());
+				KCL::RTTI_Private::RegistrationError("Several types are registered with the same name, name lookups would miss one");
+			}
+			bucket.push_back(Slot{hash, typeInfo});
+		}
+
+		// Place the largest buckets first while there are many free slots
+		std::vector<uint32_t> bucketOrder(buckets.size());
+		for (uint32_t i = 0; i < bucketOrder.size(); ++i)
+			bucketOrder[i] = i;
+		std::stable_sort(bucketOrder.begin(), bucketOrder.end(),
+						 [&buckets](uint32_t aLeft, uint32_t aRight) { return buckets[aLeft].size() > buckets[aRight].size(); });
+
+		std::vector<uint32_t> bucketSlots;
+		for (uint32_t bucketIndex : bucketOrder)
+		{
+			const std::vector<Slot>& bucket = buckets[bucketIndex];
+			if (bucket.empty())
+				break;
+
+			for (uint64_t seed = 0;; ++seed)
+			{
+				const uint64_t displacement = seed * 0xC2B2AE3D27D4EB4Full;
+				bucketSlots.clear();
+				for (const Slot& slot : bucket)
+				{
+					const uint32_t slotIndex = GetSlotIndex(slot.myHash, displacement);
+					if (mySlots[slotIndex].myTypeInfo != nullptr
+						|| std::find(bucketSlots.begin(), bucketSlots.end(), slotIndex) != bucketSlots.end())
+						break;
+					bucketSlots.push_back(slotIndex);
+				}
+
+				if (bucketSlots.size() == bucket.size())
+				{
+					for (size_t i = 0; i < bucket.size(); ++i)
+						mySlots[bucketSlots[i]] = bucket[i];
+					myBucketDisplacements[bucketIndex] = displacement;
+					break;
+				}
+			}
+		}
+	}
+
+	// Hashes 8 characters at a time, the last word overlapping the previous one so that there is no byte loop.
+	// 64 bits are wide enough that distinct names practically never share a hash.
+	// The table is built at runtime so the hash does not need to be stable across platforms.
+	static uint64_t HashName(const char* aName, size_t aLength)
+	{
+		const uint8_t* chars = reinterpret_cast<const uint8_t*>(aName);
+		const uint8_t* end = chars + aLength;
+		uint64_t hash = 0xCBF29CE484222325ull ^ aLength;
+		uint64_t tail = 0;
+
+		if (aLength > 8)
+		{
+			for (; end - chars > 8; chars += 8)
+				hash = MixHash(hash ^ ReadUnaligned<uint64_t>(chars));
+			tail = ReadUnaligned<uint64_t>(end - 8);
+		}
+		else if (aLength >= 4)
+			tail = ((uint64_t)ReadUnaligned<uint32_t>(chars) << 32) | ReadUnaligned<uint32_t>(end - 4);
+		else if (aLength > 0)
+			tail = ((uint64_t)chars[0] << 16) | ((uint64_t)chars[aLength / 2] << 8) | chars[aLength - 1];
+
+		return MixHash(hash ^ tail);
+	}
+
+	// Spreads every bit of the input over the whole output, high bits select the bucket and low bits the slot
+	KCL_FORCEINLINE static uint64_t MixHash(uint64_t aHash)
+	{
+		aHash *= 0x9E3779B97F4A7C15ull;
+		return aHash ^ (aHash >> 32);
+	}
+
+	template<typename T>
+	KCL_FORCEINLINE static T ReadUnaligned(const uint8_t* aPtr)
+	{
+		T value;
+		memcpy(&value, aPtr, sizeof(T));
+		return value;
+	}
+
+	// Maps a 32 bits value to [0, aRange) without a division
+	KCL_FORCEINLINE static uint32_t ReduceRange(uint32_t aValue, size_t aRange) { return (uint32_t)(((uint64_t)aValue * aRange) >> 32); }
+
+	KCL_FORCEINLINE uint32_t GetBucketIndex(uint64_t aHash) const
+	{
+		return ReduceRange((uint32_t)(aHash >> 32), myBucketDisplacements.size());
+	}
+
+	// Mixing after applying the displacement moves the names of a bucket to unrelated slots for every seed.
+	// Mixing is a bijection, names with distinct hashes get distinct mixed values for every seed.
+	KCL_FORCEINLINE uint32_t GetSlotIndex(uint64_t aHash, uint64_t aDisplacement) const
+	{
+		return ReduceRange((uint32_t)MixHash(aHash ^ aDisplacement), mySlots.size());
+	}
+
+	std::vector<const TypeInfo*> myTypes;
+	std::vector<uint64_t> myBucketDisplacements;
+	std::vector<Slot> mySlots;
+	const KCL::RTTI_Private::TypeRegistration* myRegistrationHead;
+};
+} // namespace RTTI
+} // namespace KCL
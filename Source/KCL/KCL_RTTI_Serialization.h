@@ -0,0 +1,471 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "KCL_RTTI.h"
+#include "KCL_RTTI_Fields.h"
+#include "KCL_RTTI_Registry.h"
+#include "KCL_RTTI_TypeMap.h"
+
+// Binary serialization of the types declared with KCL_RTTI_FIELDS, written to a growing buffer and read back from memory.
+// Values are copied as they are in memory: trivially copyable values, arrays of them, and the runs of trivial fields
+// that follow each other in an object are each a single copy. Fields of registered types are written recursively, and
+// pointers to polymorphic types as the type of the object followed by its fields, rebuilt through the registry.
+// Note:
+// * The format is the memory layout, it is read by the same build or one with the same type layouts and endianness.
+// * Types are written by name the first time they appear in the stream and by index afterwards, type ids are not
+//   stable from one run to the next when types are registered on first use.
+// * Types rebuilt from a pointer must be default constructible, they are allocated with new and owned by the pointer
+//   they are read to. Pointers must form a tree, an object pointed to twice is written twice.
+// * Fields of an object are written in offset order, Unsupported fields are skipped and assert.
+// * Arrays of trivially copyable values are aligned in the stream, ReadArrayInPlace returns them without any copy
+//   provided the read buffer is aligned like the written one, to alignof(std::max_align_t).
+// * Types that are not trivially copyable must declare their fields, writing one that does not asserts and reading it fails.
+// * Reads past the end or of an unknown type invalidate the reader, the value being read is left partially read. The
+//   objects already rebuilt to its pointers are deleted and the pointers reset to null.
+
+/*Usage :
+
+KCL::RTTI::BinaryWriter writer;
+writer.Write(transform);
+writer.WriteArray(particles.data(), particles.size());
+writer.WritePolymorphic<Shape>(shape);
+
+KCL::RTTI::BinaryReader reader(writer.GetData(), writer.GetSize());
+reader.Read(transform);
+size_t particleCount = 0;
+const Particle* particles = reader.ReadArrayInPlace<Particle>(particleCount);
+Shape* shape = reader.ReadPolymorphic<Shape>();
+if (!reader.IsValid())
+	return false;
+
+*/
+
+namespace KCL
+{
+namespace RTTI
+{
+class BinaryWriter
+{
+public:
+	BinaryWriter()
+		: mySize(0)
+		, myCapacity(0)
+	{
+	}
+
+	KCL_FORCEINLINE const uint8_t* GetData() const { return myData.get(); }
+	KCL_FORCEINLINE size_t GetSize() const { return mySize; }
+
+	// Keeps the memory for the next writes
+	KCL_FORCEINLINE void Clear()
+	{
+		mySize = 0;
+		myTypeIndices.Clear();
+	}
+
+	void Reserve(size_t aCapacity)
+	{
+		if (aCapacity > myCapacity)
+			Grow(aCapacity);
+	}
+
+	KCL_FORCEINLINE void WriteBytes(const void* someBytes, size_t aSize)
+	{
+		if (mySize + aSize > myCapacity)
+			Grow(std::max(myCapacity * 2, mySize + aSize));
+		if (aSize > 0)
+			memcpy(myData.get() + mySize, someBytes, aSize);
+		mySize += aSize;
+	}
+
+	// Non trivially copyable types are written with their fields, as their static type
+	template<typename T>
+	KCL_FORCEINLINE void Write(const T& aValue)
+	{
+		if constexpr (std::is_trivially_copyable<T>::value)
+			WriteBytes(&aValue, sizeof(T));
+		else
+			WriteObject((intptr_t)&aValue, GetTypeInfo<T>());
+	}
+
+	// Writes the count then the values, trivially copyable values in a single copy
+	template<typename T>
+	void WriteArray(const T* someValues, size_t aCount)
+	{
+		Write<uint64_t>(aCount);
+		if constexpr (std::is_trivially_copyable<T>::value)
+		{
+			Align(alignof(T));
+			WriteBytes(someValues, aCount * sizeof(T));
+		}
+		else
+		{
+			for (size_t i = 0; i < aCount; ++i)
+				WriteObject((intptr_t)(someValues + i), GetTypeInfo<T>());
+		}
+	}
+
+	// Writes the type of the object and the fields of its dynamic type, nullptr is written as type index 0
+	template<typename T>
+	void WritePolymorphic(const T* anObject)
+	{
+		const TypeInfo* typeInfo = nullptr;
+		const intptr_t object = GetMostDerived(anObject, typeInfo);
+		WriteDynamic(object, typeInfo);
+	}
+
+	// Writes the fields of an object whose most derived type is aTypeInfo
+	void WriteObject(intptr_t anObject, const TypeInfo* aTypeInfo)
+	{
+		const FieldList& fields = aTypeInfo->GetFields();
+		// It would be written as nothing and read back default constructed, the reader fails on such types
+		assert(fields.GetCount() != 0 && "The type does not declare its fields with KCL_RTTI_FIELDS");
+		for (const FieldRun* run = fields.GetRunsBegin(); run != fields.GetRunsEnd(); ++run)
+		{
+			if (!run->myField)
+			{
+				WriteBytes(reinterpret_cast<const void*>(anObject + run->myOffset), run->mySize);
+				continue;
+			}
+
+			const FieldInfo& field = *run->myField;
+			switch (field.myKind)
+			{
+			case FieldKind::Object:
+				WriteObject(anObject + field.myOffset, field.GetTypeInfo());
+				break;
+			case FieldKind::Pointer:
+			{
+				const TypeInfo* typeInfo = nullptr;
+				const intptr_t object = field.GetPointee(anObject, typeInfo);
+				WriteDynamic(object, typeInfo);
+				break;
+			}
+			default:
+				assert(false && "Field cannot be serialized");
+				break;
+			}
+		}
+	}
+
+private:
+	void WriteDynamic(intptr_t anObject, const TypeInfo* aTypeInfo)
+	{
+		if (!anObject)
+		{
+			Write<uint32_t>(0);
+			return;
+		}
+
+		// Indices start at 1, the first object of a type is followed by the name of the type
+		uint32_t& typeIndex = myTypeIndices.FindOrAdd(aTypeInfo->GetTypeId());
+		if (typeIndex == 0)
+		{
+			typeIndex = (uint32_t)myTypeIndices.GetCount();
+			const uint32_t length = (uint32_t)strlen(aTypeInfo->GetName());
+			Write<uint32_t>(typeIndex);
+			Write<uint32_t>(length);
+			WriteBytes(aTypeInfo->GetName(), length);
+		}
+		else
+			Write<uint32_t>(typeIndex);
+
+		WriteObject(anObject, aTypeInfo);
+	}
+
+	void Align(size_t anAlignment)
+	{
+		static const uint8_t theZeros[alignof(std::max_align_t)] = {};
+		assert(anAlignment <= sizeof(theZeros) && "Over aligned types are not supported");
+		WriteBytes(theZeros, (0 - mySize) & (anAlignment - 1));
+	}
+
+	void Grow(size_t aCapacity)
+	{
+		// Not value initialized, the bytes are written before they are read
+		std::unique_ptr<uint8_t[]> data(new uint8_t[aCapacity]);
+		if (mySize > 0)
+			memcpy(data.get(), myData.get(), mySize);
+		myData = std::move(data);
+		myCapacity = aCapacity;
+	}
+
+	std::unique_ptr<uint8_t[]> myData;
+	size_t mySize;
+	size_t myCapacity;
+	// Index of each type in the stream
+	TypeMap<uint32_t> myTypeIndices;
+};
+
+class BinaryReader
+{
+public:
+	// The data must outlive the reader, and the arrays read in place
+	BinaryReader(const void* someData, size_t aSize)
+		: myData(static_cast<const uint8_t*>(someData))
+		, mySize(aSize)
+		, myPosition(0)
+		, myIsValid(true)
+	{
+	}
+
+	// False once a read failed, all the following reads fail
+	KCL_FORCEINLINE bool IsValid() const { return myIsValid; }
+	KCL_FORCEINLINE size_t GetRemainingSize() const { return mySize - myPosition; }
+
+	KCL_FORCEINLINE bool ReadBytes(void* someBytesOut, size_t aSize)
+	{
+		const uint8_t* bytes = Consume(aSize);
+		if (!bytes)
+			return false;
+		if (aSize > 0)
+			memcpy(someBytesOut, bytes, aSize);
+		return true;
+	}
+
+	template<typename T>
+	KCL_FORCEINLINE bool Read(T& aValueOut)
+	{
+		if constexpr (std::is_trivially_copyable<T>::value)
+			return ReadBytes(&aValueOut, sizeof(T));
+		else
+			return ReadObject((intptr_t)&aValueOut, GetTypeInfo<T>());
+	}
+
+	template<typename T>
+	bool ReadArray(std::vector<T>& someValuesOut)
+	{
+		someValuesOut.clear();
+		uint64_t count = 0;
+		if (!Read(count))
+			return false;
+
+		if constexpr (std::is_trivially_copyable<T>::value)
+		{
+			if (!Align(alignof(T)) || count > GetRemainingSize() / sizeof(T))
+				return Fail();
+			someValuesOut.resize((size_t)count);
+			return ReadBytes(someValuesOut.data(), (size_t)count * sizeof(T));
+		}
+		else
+		{
+			for (uint64_t i = 0; i < count; ++i)
+			{
+				someValuesOut.emplace_back();
+				if (!ReadObject((intptr_t)&someValuesOut.back(), GetTypeInfo<T>()))
+					return false;
+			}
+			return true;
+		}
+	}
+
+	// Returns the values in the read buffer without copying them, nullptr if the array could not be read
+	template<typename T>
+	const T* ReadArrayInPlace(size_t& aCountOut)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read in place");
+
+		aCountOut = 0;
+		uint64_t count = 0;
+		if (!Read(count) || !Align(alignof(T)) || count > GetRemainingSize() / sizeof(T))
+		{
+			Fail();
+			return nullptr;
+		}
+
+		const uint8_t* values = myData + myPosition;
+		if ((uintptr_t)values % alignof(T) != 0)
+		{
+			assert(false && "The read buffer is not aligned like the written one");
+			Fail();
+			return nullptr;
+		}
+
+		myPosition += (size_t)count * sizeof(T);
+		aCountOut = (size_t)count;
+		return reinterpret_cast<const T*>(values);
+	}
+
+	// Rebuilds an object written by WritePolymorphic, allocated with new and owned by the caller.
+	// nullptr if the written pointer was null, if the read failed or if the object is not a T
+	template<typename T>
+	T* ReadPolymorphic()
+	{
+		return reinterpret_cast<T*>(ReadDynamic(GetTypeId<T>()));
+	}
+
+	// Reads the fields of an object whose most derived type is aTypeInfo.
+	// On failure, the objects already read to its pointer fields are deleted and the pointers reset to null.
+	bool ReadObject(intptr_t anObject, const TypeInfo* aTypeInfo)
+	{
+		const FieldList& fields = aTypeInfo->GetFields();
+		if (fields.GetCount() == 0)
+			return Fail();
+
+		for (const FieldRun* run = fields.GetRunsBegin(); run != fields.GetRunsEnd(); ++run)
+		{
+			if (!ReadRun(anObject, *run))
+			{
+				DeletePointees(anObject, fields.GetRunsBegin(), run);
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	KCL_FORCEINLINE bool Fail()
+	{
+		myIsValid = false;
+		return false;
+	}
+
+	KCL_FORCEINLINE const uint8_t* Consume(size_t aSize)
+	{
+		if (!myIsValid || aSize > GetRemainingSize())
+		{
+			Fail();
+			return nullptr;
+		}
+
+		const uint8_t* bytes = myData + myPosition;
+		myPosition += aSize;
+		return bytes;
+	}
+
+	bool Align(size_t anAlignment)
+	{
+		return Consume((0 - myPosition) & (anAlignment - 1)) != nullptr;
+	}
+
+	bool ReadRun(intptr_t anObject, const FieldRun& aRun)
+	{
+		if (!aRun.myField)
+			return ReadBytes(reinterpret_cast<void*>(anObject + aRun.myOffset), aRun.mySize);
+
+		const FieldInfo& field = *aRun.myField;
+		switch (field.myKind)
+		{
+		case FieldKind::Object:
+			return ReadObject(anObject + field.myOffset, field.GetTypeInfo());
+		case FieldKind::Pointer:
+			// Pointers have the same representation whatever the type pointed to
+			*reinterpret_cast<intptr_t*>(anObject + field.myOffset) = ReadDynamic(field.GetTypeInfo()->GetTypeId());
+			return myIsValid;
+		default:
+			assert(false && "Field cannot be serialized");
+			return true;
+		}
+	}
+
+	// Deletes the objects read to the pointer fields of the runs and of their nested objects, the pointers are reset to null
+	// so that the destructor of a type that owns them does not delete them again
+	void DeletePointees(intptr_t anObject, const FieldRun* aBegin, const FieldRun* anEnd)
+	{
+		for (const FieldRun* run = aBegin; run != anEnd; ++run)
+		{
+			if (!run->myField)
+				continue;
+
+			const FieldInfo& field = *run->myField;
+			if (field.myKind == FieldKind::Object)
+			{
+				const FieldList& fields = field.GetTypeInfo()->GetFields();
+				DeletePointees(anObject + field.myOffset, fields.GetRunsBegin(), fields.GetRunsEnd());
+			}
+			else if (field.myKind == FieldKind::Pointer)
+			{
+				const TypeInfo* typeInfo = nullptr;
+				const intptr_t object = field.GetPointee(anObject, typeInfo);
+				if (!object)
+					continue;
+
+				const FieldList& fields = typeInfo->GetFields();
+				DeletePointees(object, fields.GetRunsBegin(), fields.GetRunsEnd());
+				typeInfo->GetObjectTraits().myDelete((void*)object);
+				*reinterpret_cast<intptr_t*>(anObject + field.myOffset) = 0;
+			}
+		}
+	}
+
+	// Returns the address of the aTargetTypeId base of the object read, 0 if null or on failure
+	intptr_t ReadDynamic(typeId_t aTargetTypeId)
+	{
+		uint32_t typeIndex = 0;
+		if (!Read(typeIndex) || typeIndex == 0)
+			return 0;
+
+		if (typeIndex == myTypes.size() + 1)
+		{
+			uint32_t length = 0;
+			if (!Read(length))
+				return 0;
+			const uint8_t* name = Consume(length);
+			if (!name)
+				return 0;
+			myTypes.push_back(TypeRegistry::GetInstance().FindByName(reinterpret_cast<const char*>(name), length));
+		}
+		else if (typeIndex > myTypes.size())
+		{
+			Fail();
+			return 0;
+		}
+
+		const TypeInfo* typeInfo = myTypes[typeIndex - 1];
+		if (!typeInfo || !typeInfo->GetObjectTraits().myNew)
+		{
+			Fail();
+			return 0;
+		}
+
+		const ObjectTraits& traits = typeInfo->GetObjectTraits();
+		const intptr_t object = (intptr_t)traits.myNew();
+		const intptr_t result = typeInfo->CastTo(object, aTargetTypeId);
+		if (result == 0 || !ReadObject(object, typeInfo))
+		{
+			traits.myDelete((void*)object);
+			Fail();
+			return 0;
+		}
+		return result;
+	}
+
+	const uint8_t* myData;
+	size_t mySize;
+	size_t myPosition;
+	bool myIsValid;
+	// Types in the order they appear in the stream, nullptr for the unknown ones
+	std::vector<const TypeInfo*> myTypes;
+};
+} // namespace RTTI
+} // namespace KCL
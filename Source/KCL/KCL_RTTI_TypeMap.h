@@ -0,0 +1,426 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "KCL_RTTI.h"
+
+// Containers keyed by type id, replacing hash maps for per-type caches, tables and statistics.
+// Counter ids are small and dense, TypeMap is a flat array indexed by type id with a bit per slot telling which slots
+// are occupied, and TypeSet is that bitset alone. A lookup is a bounds check, a bit test and an indexed load.
+// With KCL_RTTI_HASHED_TYPEID ids are spread over 32 bits, both containers use open addressing on the type id instead.
+// Note:
+// * Lookups never allocate, the arrays grow on insertion only. With counter ids, the arrays are as large as the
+//   largest id inserted.
+// * TypeMap values are default constructible, empty slots hold a default constructed value.
+// * ForEach visits occupied slots by increasing type id with counter ids, in no particular order with hashed ids.
+// * Inserting or removing invalidates pointers to values.
+
+/*Usage :
+
+KCL::RTTI::TypeMap<size_t> instanceCounts;
+++instanceCounts.FindOrAdd(entity->KCL_RTTI_GetTypeId());
+
+if (const size_t* count = instanceCounts.Find(KCL::RTTI::GetTypeId<Monster>()))
+	printf("%zu monsters\n", *count);
+
+instanceCounts.ForEach([](KCL::RTTI::typeId_t aTypeId, size_t aCount) { printf("%u: %zu\n", (uint32_t)aTypeId, aCount); });
+
+KCL::RTTI::TypeSet updatedTypes;
+updatedTypes.Add(KCL::RTTI::GetTypeId<Monster>());
+
+*/
+
+namespace KCL
+{
+#if KCL_RTTI_HASHED_TYPEID
+namespace RTTI_Private
+{
+// Slot holding the type id, or the empty slot ending its probe sequence. Type ids are never 0, which marks empty slots.
+KCL_FORCEINLINE uint32_t FindTypeIdSlot(const std::vector<RTTI::typeId_t>& someTypeIds, RTTI::typeId_t aTypeId)
+{
+	const uint32_t mask = (uint32_t)someTypeIds.size() - 1;
+	uint32_t slot = aTypeId & mask;
+	while (someTypeIds[slot] != aTypeId && someTypeIds[slot] != 0)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+// Empties the slot and moves back the ids following it in the probe sequence, so that no lookup stops early.
+// aMoveFunction(from, to) moves the value attached to a slot.
+template<typename MoveFunction>
+void EraseTypeIdSlot(std::vector<RTTI::typeId_t>& someTypeIds, uint32_t aSlot, MoveFunction aMoveFunction)
+{
+	const uint32_t mask = (uint32_t)someTypeIds.size() - 1;
+	uint32_t emptySlot = aSlot;
+	for (uint32_t slot = (aSlot + 1) & mask; someTypeIds[slot] != 0; slot = (slot + 1) & mask)
+	{
+		// Ids whose home slot lies between the empty slot and their slot stay where they are
+		const uint32_t home = someTypeIds[slot] & mask;
+		if (((slot - home) & mask) < ((slot - emptySlot) & mask))
+			continue;
+
+		someTypeIds[emptySlot] = someTypeIds[slot];
+		aMoveFunction(slot, emptySlot);
+		emptySlot = slot;
+	}
+	someTypeIds[emptySlot] = 0;
+}
+} // namespace RTTI_Private
+#endif
+
+namespace RTTI
+{
+#if !KCL_RTTI_HASHED_TYPEID
+class TypeSet
+{
+public:
+	TypeSet()
+		: myCount(0)
+	{
+	}
+
+	KCL_FORCEINLINE bool Contains(typeId_t aTypeId) const
+	{
+		const size_t wordIndex = aTypeId / theWordBitCount;
+		return wordIndex < myWords.size() && (myWords[wordIndex] >> (aTypeId % theWordBitCount)) & 1;
+	}
+
+	// Returns false if the type id was already in the set
+	bool Add(typeId_t aTypeId)
+	{
+		const size_t wordIndex = aTypeId / theWordBitCount;
+		if (wordIndex >= myWords.size())
+			myWords.resize(wordIndex + 1, 0);
+
+		const uint32_t bit = 1u << (aTypeId % theWordBitCount);
+		if (myWords[wordIndex] & bit)
+			return false;
+
+		myWords[wordIndex] |= bit;
+		++myCount;
+		return true;
+	}
+
+	// Returns false if the type id was not in the set
+	bool Remove(typeId_t aTypeId)
+	{
+		if (!Contains(aTypeId))
+			return false;
+
+		myWords[aTypeId / theWordBitCount] &= ~(1u << (aTypeId % theWordBitCount));
+		--myCount;
+		return true;
+	}
+
+	void Clear()
+	{
+		myWords.clear();
+		myCount = 0;
+	}
+
+	// Calls aFunction(typeId_t) for each type id of the set
+	template<typename Function>
+	void ForEach(Function aFunction) const
+	{
+		for (size_t wordIndex = 0; wordIndex < myWords.size(); ++wordIndex)
+		{
+			for (uint32_t word = myWords[wordIndex]; word != 0; word &= word - 1)
+				aFunction((typeId_t)(wordIndex * theWordBitCount + KCL_CountTrailingZeros(word)));
+		}
+	}
+
+	KCL_FORCEINLINE size_t GetCount() const { return myCount; }
+	KCL_FORCEINLINE bool IsEmpty() const { return myCount == 0; }
+
+	size_t GetByteSize() const { return myWords.size() * sizeof(uint32_t); }
+
+private:
+	static constexpr size_t theWordBitCount = 32;
+
+	std::vector<uint32_t> myWords;
+	size_t myCount;
+};
+
+template<typename V>
+class TypeMap
+{
+public:
+	KCL_FORCEINLINE V* Find(typeId_t aTypeId) { return myTypeIds.Contains(aTypeId) ? &myValues[aTypeId] : nullptr; }
+	KCL_FORCEINLINE const V* Find(typeId_t aTypeId) const { return myTypeIds.Contains(aTypeId) ? &myValues[aTypeId] : nullptr; }
+
+	KCL_FORCEINLINE bool Contains(typeId_t aTypeId) const { return myTypeIds.Contains(aTypeId); }
+
+	// Default constructs the value if the type id is not in the map
+	V& FindOrAdd(typeId_t aTypeId)
+	{
+		if (aTypeId >= myValues.size())
+			myValues.resize((size_t)aTypeId + 1);
+		myTypeIds.Add(aTypeId);
+		return myValues[aTypeId];
+	}
+
+	// Replaces the value if the type id is already in the map
+	V& Add(typeId_t aTypeId, V aValue)
+	{
+		V& value = FindOrAdd(aTypeId);
+		value = std::move(aValue);
+		return value;
+	}
+
+	// Returns false if the type id was not in the map
+	bool Remove(typeId_t aTypeId)
+	{
+		if (!myTypeIds.Remove(aTypeId))
+			return false;
+
+		// Releases what the value holds
+		myValues[aTypeId] = V();
+		return true;
+	}
+
+	void Clear()
+	{
+		myTypeIds.Clear();
+		myValues.clear();
+	}
+
+	// Calls aFunction(typeId_t, V&) for each entry of the map
+	template<typename Function>
+	void ForEach(Function aFunction)
+	{
+		myTypeIds.ForEach([this, &aFunction](typeId_t aTypeId) { aFunction(aTypeId, myValues[aTypeId]); });
+	}
+
+	template<typename Function>
+	void ForEach(Function aFunction) const
+	{
+		myTypeIds.ForEach([this, &aFunction](typeId_t aTypeId) { aFunction(aTypeId, myValues[aTypeId]); });
+	}
+
+	KCL_FORCEINLINE size_t GetCount() const { return myTypeIds.GetCount(); }
+	KCL_FORCEINLINE bool IsEmpty() const { return myTypeIds.IsEmpty(); }
+
+	size_t GetByteSize() const { return myTypeIds.GetByteSize() + myValues.size() * sizeof(V); }
+
+private:
+	TypeSet myTypeIds;
+	std::vector<V> myValues;
+};
+#else
+class TypeSet
+{
+public:
+	TypeSet()
+		: myTypeIds(2, 0)
+		, myCount(0)
+	{
+	}
+
+	KCL_FORCEINLINE bool Contains(typeId_t aTypeId) const
+	{
+		return myTypeIds[RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId)] == aTypeId;
+	}
+
+	// Returns false if the type id was already in the set
+	bool Add(typeId_t aTypeId)
+	{
+		if (Contains(aTypeId))
+			return false;
+
+		// Power of two with at least half of the slots empty
+		if ((myCount + 1) * 2 > myTypeIds.size())
+		{
+			std::vector<typeId_t> typeIds(myTypeIds.size() * 2, 0);
+			typeIds.swap(myTypeIds);
+			for (typeId_t typeId : typeIds)
+				if (typeId != 0)
+					myTypeIds[RTTI_Private::FindTypeIdSlot(myTypeIds, typeId)] = typeId;
+		}
+
+		myTypeIds[RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId)] = aTypeId;
+		++myCount;
+		return true;
+	}
+
+	// Returns false if the type id was not in the set
+	bool Remove(typeId_t aTypeId)
+	{
+		const uint32_t slot = RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId);
+		if (myTypeIds[slot] != aTypeId)
+			return false;
+
+		RTTI_Private::EraseTypeIdSlot(myTypeIds, slot, [](uint32_t, uint32_t) {});
+		--myCount;
+		return true;
+	}
+
+	void Clear()
+	{
+		myTypeIds.assign(2, 0);
+		myCount = 0;
+	}
+
+	// Calls aFunction(typeId_t) for each type id of the set
+	template<typename Function>
+	void ForEach(Function aFunction) const
+	{
+		for (typeId_t typeId : myTypeIds)
+			if (typeId != 0)
+				aFunction(typeId);
+	}
+
+	KCL_FORCEINLINE size_t GetCount() const { return myCount; }
+	KCL_FORCEINLINE bool IsEmpty() const { return myCount == 0; }
+
+	size_t GetByteSize() const { return myTypeIds.size() * sizeof(typeId_t); }
+
+private:
+	std::vector<typeId_t> myTypeIds;
+	size_t myCount;
+};
+
+template<typename V>
+class TypeMap
+{
+public:
+	TypeMap()
+		: myTypeIds(2, 0)
+		, myValues(2)
+		, myCount(0)
+	{
+	}
+
+	KCL_FORCEINLINE V* Find(typeId_t aTypeId)
+	{
+		const uint32_t slot = RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId);
+		return myTypeIds[slot] == aTypeId ? &myValues[slot] : nullptr;
+	}
+
+	KCL_FORCEINLINE const V* Find(typeId_t aTypeId) const
+	{
+		const uint32_t slot = RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId);
+		return myTypeIds[slot] == aTypeId ? &myValues[slot] : nullptr;
+	}
+
+	KCL_FORCEINLINE bool Contains(typeId_t aTypeId) const { return Find(aTypeId) != nullptr; }
+
+	// Default constructs the value if the type id is not in the map
+	V& FindOrAdd(typeId_t aTypeId)
+	{
+		uint32_t slot = RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId);
+		if (myTypeIds[slot] == aTypeId)
+			return myValues[slot];
+
+		// Power of two with at least half of the slots empty
+		if ((myCount + 1) * 2 > myTypeIds.size())
+		{
+			std::vector<typeId_t> typeIds(myTypeIds.size() * 2, 0);
+			std::vector<V> values(myValues.size() * 2);
+			typeIds.swap(myTypeIds);
+			values.swap(myValues);
+			for (size_t i = 0; i < typeIds.size(); ++i)
+			{
+				if (typeIds[i] != 0)
+				{
+					const uint32_t newSlot = RTTI_Private::FindTypeIdSlot(myTypeIds, typeIds[i]);
+					myTypeIds[newSlot] = typeIds[i];
+					myValues[newSlot] = std::move(values[i]);
+				}
+			}
+			slot = RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId);
+		}
+
+		myTypeIds[slot] = aTypeId;
+		++myCount;
+		return myValues[slot];
+	}
+
+	// Replaces the value if the type id is already in the map
+	V& Add(typeId_t aTypeId, V aValue)
+	{
+		V& value = FindOrAdd(aTypeId);
+		value = std::move(aValue);
+		return value;
+	}
+
+	// Returns false if the type id was not in the map
+	bool Remove(typeId_t aTypeId)
+	{
+		const uint32_t slot = RTTI_Private::FindTypeIdSlot(myTypeIds, aTypeId);
+		if (myTypeIds[slot] != aTypeId)
+			return false;
+
+		// The slot left empty at the end releases what its value holds
+		uint32_t emptySlot = slot;
+		RTTI_Private::EraseTypeIdSlot(myTypeIds, slot, [this, &emptySlot](uint32_t aFrom, uint32_t aTo) {
+			myValues[aTo] = std::move(myValues[aFrom]);
+			emptySlot = aFrom;
+		});
+		myValues[emptySlot] = V();
+		--myCount;
+		return true;
+	}
+
+	void Clear()
+	{
+		myTypeIds.assign(2, 0);
+		myValues.clear();
+		myValues.resize(2);
+		myCount = 0;
+	}
+
+	// Calls aFunction(typeId_t, V&) for each entry of the map
+	template<typename Function>
+	void ForEach(Function aFunction)
+	{
+		for (size_t i = 0; i < myTypeIds.size(); ++i)
+			if (myTypeIds[i] != 0)
+				aFunction(myTypeIds[i], myValues[i]);
+	}
+
+	template<typename Function>
+	void ForEach(Function aFunction) const
+	{
+		for (size_t i = 0; i < myTypeIds.size(); ++i)
+			if (myTypeIds[i] != 0)
+				aFunction(myTypeIds[i], myValues[i]);
+	}
+
+	KCL_FORCEINLINE size_t GetCount() const { return myCount; }
+	KCL_FORCEINLINE bool IsEmpty() const { return myCount == 0; }
+
+	size_t GetByteSize() const { return myTypeIds.size() * sizeof(typeId_t) + myValues.size() * sizeof(V); }
+
+private:
+	std::vector<typeId_t> myTypeIds;
+	std::vector<V> myValues;
+	size_t myCount;
+};
+#endif
+} // namespace RTTI
+} // namespace KCL
@@ -74,7 +74,7 @@ _61,_62,_63,N,...) N
 19,18,17,16,15,14,13,12,11,10, \
 9,8,7,6,5,4,3,2,1,0
 
-// Foreach macro applies a macro to all of the following arguments
+// Foreach macro applies a macro to all of the following arguments, up to 63 arguments
 #define KCL_FOREACH(MACRO, ...) KCL_EXPAND(_KCL_FOREACH_IMPL(KCL_VA_COUNT(__VA_ARGS__), MACRO, __VA_ARGS__))
 
 #define _KCL_FOREACH_1(MACRO, FIRST, ...) MACRO(FIRST)
@@ -85,11 +85,66 @@ _61,_62,_63,N,...) N
 #define _KCL_FOREACH_6(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_5(MACRO, __VA_ARGS__))
 #define _KCL_FOREACH_7(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_6(MACRO, __VA_ARGS__))
 #define _KCL_FOREACH_8(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_7(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_9(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_8(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_10(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_9(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_11(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_10(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_12(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_11(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_13(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_12(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_14(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_13(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_15(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_14(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_16(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_15(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_17(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_16(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_18(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_17(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_19(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_18(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_20(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_19(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_21(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_20(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_22(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_21(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_23(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_22(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_24(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_23(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_25(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_24(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_26(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_25(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_27(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_26(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_28(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_27(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_29(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_28(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_30(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_29(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_31(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_30(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_32(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_31(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_33(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_32(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_34(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_33(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_35(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_34(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_36(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_35(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_37(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_36(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_38(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_37(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_39(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_38(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_40(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_39(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_41(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_40(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_42(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_41(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_43(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_42(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_44(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_43(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_45(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_44(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_46(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_45(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_47(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_46(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_48(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_47(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_49(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_48(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_50(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_49(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_51(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_50(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_52(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_51(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_53(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_52(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_54(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_53(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_55(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_54(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_56(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_55(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_57(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_56(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_58(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_57(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_59(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_58(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_60(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_59(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_61(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_60(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_62(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_61(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_63(MACRO, FIRST, ...) MACRO(FIRST) KCL_EXPAND(_KCL_FOREACH_62(MACRO, __VA_ARGS__))
 
 #define _KCL_FOREACH_IMPL(N, MACRO, ...) KCL_EXPAND(KCL_CONCATENATE(_KCL_FOREACH_, N)(MACRO, __VA_ARGS__))
 
 
-// Foreach with a macro of two parameters
+// Foreach with a macro of two parameters, up to 62 arguments
 // Will not compile with odd number of parameters
 #define KCL_FOREACH_2ARGS(MACRO, ...) KCL_EXPAND(_KCL_FOREACH_IMPL_2ARGS(KCL_VA_COUNT(__VA_ARGS__), MACRO, __VA_ARGS__))
 
@@ -101,5 +156,28 @@ _61,_62,_63,N,...) N
 #define _KCL_FOREACH_2ARGS_12(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_10(MACRO, __VA_ARGS__))
 #define _KCL_FOREACH_2ARGS_14(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_12(MACRO, __VA_ARGS__))
 #define _KCL_FOREACH_2ARGS_16(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_14(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_18(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_16(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_20(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_18(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_22(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_20(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_24(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_22(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_26(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_24(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_28(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_26(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_30(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_28(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_32(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_30(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_34(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_32(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_36(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_34(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_38(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_36(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_40(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_38(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_42(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_40(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_44(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_42(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_46(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_44(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_48(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_46(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_50(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_48(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_52(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_50(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_54(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_52(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_56(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_54(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_58(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_56(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_60(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_58(MACRO, __VA_ARGS__))
+#define _KCL_FOREACH_2ARGS_62(MACRO, FIRST, SECOND, ...) MACRO(FIRST, SECOND) KCL_EXPAND(_KCL_FOREACH_2ARGS_60(MACRO, __VA_ARGS__))
 
 #define _KCL_FOREACH_IMPL_2ARGS(N, MACRO, ...) KCL_EXPAND(KCL_CONCATENATE(_KCL_FOREACH_2ARGS_, N)(MACRO, __VA_ARGS__))
@@ -0,0 +1,545 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "KCL_Benchmark.h"
+
+#include "KCL_PerfCounters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#elif defined(__linux__)
+#	include <sched.h>
+#endif
+
+namespace KCL_Test
+{
+namespace
+{
+struct BenchmarkResult
+{
+	std::string myName;
+	std::string myNote;
+	size_t myItemCount;
+	double myMinTime;
+	double myMedianTime;
+	double myP99Time;
+	// Negative if the case is not in the baseline
+	double myBaselineMedianTime;
+	bool myIsRegression;
+	// Events per item over the timed repetitions, negative if the counter is unavailable or not requested
+	double myCounters[PerfCounters::theCount];
+};
+
+void PrintUsage()
+{
+	printf("Options:\n"
+		   "  --filter=A,B       Runs the cases whose name contains A or B\n"
+		   "  --list             Lists the selected cases without running them\n"
+		   "  --warmup=N         Untimed runs before measuring, default 1\n"
+		   "  --repetitions=N    Timed runs, default 10\n"
+		   "  --cpu=N            Pins the benchmark thread to a core, threads of scaling cases to the next cores\n"
+		   "  --threads=N        Maximum thread count of scaling cases, default all cores\n"
+		   "  --counters         Reports hardware counters per item, Linux only\n"
+		   "  --format=F         text, csv or json, default text\n"
+		   "  --output=PATH      Writes the report to a file instead of the standard output\n"
+		   "  --baseline=PATH    Compares with a CSV report of a previous run\n"
+		   "  --threshold=P      Percentage of slowdown of the median flagged as a regression, default 5\n");
+}
+
+bool ParseFormat(const char* aValue, BenchmarkFormat& aFormatOut)
+{
+	if (strcmp(aValue, "text") == 0)
+		aFormatOut = BenchmarkFormat::Text;
+	else if (strcmp(aValue, "csv") == 0)
+		aFormatOut = BenchmarkFormat::CSV;
+	else if (strcmp(aValue, "json") == 0)
+		aFormatOut = BenchmarkFormat::JSON;
+	else
+		return false;
+	return true;
+}
+
+// Returns the value of --name=value, nullptr if anArg is another option
+const char* GetOptionValue(const char* anArg, const char* aName)
+{
+	const size_t length = strlen(aName);
+	return (strncmp(anArg, aName, length) == 0 && anArg[length] == '=') ? anArg + length + 1 : nullptr;
+}
+
+std::vector<std::string> Split(const std::string& aString, char aSeparator)
+{
+	std::vector<std::string> parts;
+	size_t start = 0;
+	for (size_t end = aString.find(aSeparator); end != std::string::npos; end = aString.find(aSeparator, start))
+	{
+		parts.push_back(aString.substr(start, end - start));
+		start = end + 1;
+	}
+	parts.push_back(aString.substr(start));
+	return parts;
+}
+
+// Fields of a CSV line, quoted fields may contain separators and doubled quotes
+std::vector<std::string> ParseCSVLine(const std::string& aLine)
+{
+	std::vector<std::string> fields(1);
+	bool isQuoted = false;
+	for (size_t i = 0; i < aLine.size(); ++i)
+	{
+		const char c = aLine[i];
+		if (isQuoted && c == '"' && i + 1 < aLine.size() && aLine[i + 1] == '"')
+			fields.back() += aLine[++i];
+		else if (c == '"')
+			isQuoted = !isQuoted;
+		else if (c == ',' && !isQuoted)
+			fields.emplace_back();
+		else if (c != '\r' && c != '\n')
+			fields.back() += c;
+	}
+	return fields;
+}
+
+std::string QuoteCSV(const std::string& aString)
+{
+	std::string quoted = "\"";
+	for (char c : aString)
+		quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+	return quoted + "\"";
+}
+
+std::string QuoteJSON(const std::string& aString)
+{
+	std::string quoted = "\"";
+	for (char c : aString)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+// Median time of every case of a CSV report, by name
+bool LoadBaseline(const std::string& aPath, std::unordered_map<std::string, double>& someMedianTimesOut)
+{
+	FILE* file = fopen(aPath.c_str(), "r");
+	if (!file)
+		return false;
+
+	std::string line;
+	size_t medianColumn = 0;
+	bool isHeader = true;
+	bool hasMedianColumn = false;
+	for (int c = fgetc(file);; c = fgetc(file))
+	{
+		if (c != '\n' && c != EOF)
+		{
+			line += (char)c;
+			continue;
+		}
+
+		if (!line.empty())
+		{
+			const std::vector<std::string> fields = ParseCSVLine(line);
+			if (isHeader)
+			{
+				medianColumn = std::find(fields.begin(), fields.end(), "median_ms") - fields.begin();
+				hasMedianColumn = medianColumn < fields.size();
+				isHeader = false;
+			}
+			else if (hasMedianColumn && medianColumn < fields.size())
+				someMedianTimesOut[fields[0]] = atof(fields[medianColumn].c_str());
+		}
+
+		line.clear();
+		if (c == EOF)
+			break;
+	}
+
+	fclose(file);
+	return hasMedianColumn;
+}
+
+bool HasCounters(const BenchmarkResult& aResult)
+{
+	for (double counter : aResult.myCounters)
+		if (counter >= 0)
+			return true;
+	return false;
+}
+
+void PrintTextResult(FILE* aFile, const BenchmarkResult& aResult, size_t aNameWidth)
+{
+	fprintf(aFile, "%-*s items: %9zu  min (ms): %10.3f  median (ms): %10.3f  p99 (ms): %10.3f  ns/item: %7.3f", (int)aNameWidth,
+		aResult.myName.c_str(), aResult.myItemCount, aResult.myMinTime, aResult.myMedianTime, aResult.myP99Time,
+		aResult.myItemCount ? aResult.myMedianTime * 1e6 / aResult.myItemCount : 0.0);
+
+	if (aResult.myBaselineMedianTime > 0)
+	{
+		fprintf(aFile, "  baseline: %+6.1f%%%s", (aResult.myMedianTime / aResult.myBaselineMedianTime - 1) * 100,
+			aResult.myIsRegression ? " REGRESSION" : "");
+	}
+	if (!aResult.myNote.empty())
+		fprintf(aFile, "  %s", aResult.myNote.c_str());
+	fprintf(aFile, "\n");
+
+	if (HasCounters(aResult))
+	{
+		fprintf(aFile, "%-*s", (int)aNameWidth, "");
+		for (size_t i = 0; i < PerfCounters::theCount; ++i)
+		{
+			if (aResult.myCounters[i] >= 0)
+				fprintf(aFile, " %s: %.3f", PerfCounters::GetName((PerfCounter)i), aResult.myCounters[i]);
+			else
+				fprintf(aFile, " %s: n/a", PerfCounters::GetName((PerfCounter)i));
+		}
+		fprintf(aFile, "\n");
+	}
+}
+
+void WriteReport(FILE* aFile, BenchmarkFormat aFormat, const std::vector<BenchmarkResult>& someResults, size_t aNameWidth)
+{
+	if (aFormat == BenchmarkFormat::Text)
+	{
+		for (const BenchmarkResult& result : someResults)
+			PrintTextResult(aFile, result, aNameWidth);
+	}
+	else if (aFormat == BenchmarkFormat::CSV)
+	{
+		// Unavailable counters are empty fields
+		fprintf(aFile, "name,items,min_ms,median_ms,p99_ms,baseline_median_ms,regression,note");
+		for (size_t i = 0; i < PerfCounters::theCount; ++i)
+			fprintf(aFile, ",%s_per_item", PerfCounters::GetName((PerfCounter)i));
+		fprintf(aFile, "\n");
+
+		for (const BenchmarkResult& result : someResults)
+		{
+			fprintf(aFile, "%s,%zu,%.6f,%.6f,%.6f,%.6f,%d,%s", QuoteCSV(result.myName).c_str(), result.myItemCount, result.myMinTime,
+				result.myMedianTime, result.myP99Time, std::max(result.myBaselineMedianTime, 0.0), result.myIsRegression ? 1 : 0,
+				QuoteCSV(result.myNote).c_str());
+			for (double counter : result.myCounters)
+			{
+				if (counter >= 0)
+					fprintf(aFile, ",%.6f", counter);
+				else
+					fprintf(aFile, ",");
+			}
+			fprintf(aFile, "\n");
+		}
+	}
+	else
+	{
+		fprintf(aFile, "{\n\t\"cases\": [");
+		for (size_t i = 0; i < someResults.size(); ++i)
+		{
+			const BenchmarkResult& result = someResults[i];
+			fprintf(aFile, "%s\n\t\t{\"name\": %s, \"items\": %zu, \"min_ms\": %.6f, \"median_ms\": %.6f, \"p99_ms\": %.6f, ", i ? "," : "",
+				QuoteJSON(result.myName).c_str(), result.myItemCount, result.myMinTime, result.myMedianTime, result.myP99Time);
+			if (result.myBaselineMedianTime > 0)
+				fprintf(aFile, "\"baseline_median_ms\": %.6f, ", result.myBaselineMedianTime);
+			else
+				fprintf(aFile, "\"baseline_median_ms\": null, ");
+			fprintf(aFile, "\"regression\": %s, \"note\": %s", result.myIsRegression ? "true" : "false", QuoteJSON(result.myNote).c_str());
+			for (size_t c = 0; c < PerfCounters::theCount; ++c)
+			{
+				if (result.myCounters[c] >= 0)
+					fprintf(aFile, ", \"%s_per_item\": %.6f", PerfCounters::GetName((PerfCounter)c), result.myCounters[c]);
+				else
+					fprintf(aFile, ", \"%s_per_item\": null", PerfCounters::GetName((PerfCounter)c));
+			}
+			fprintf(aFile, "}");
+		}
+		fprintf(aFile, "\n\t]\n}\n");
+	}
+}
+} // namespace
+
+bool PinThread(int aCpu)
+{
+#if defined(_WIN32)
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << aCpu) != 0;
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(aCpu, &cpuSet);
+	return sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ParseBenchmarkOptions(int anArgCount, const char* const* someArgs, BenchmarkOptions& someOptionsOut)
+{
+	for (int i = 1; i < anArgCount; ++i)
+	{
+		const char* arg = someArgs[i];
+		const char* value = nullptr;
+
+		if ((value = GetOptionValue(arg, "--filter")))
+			someOptionsOut.myFilters = Split(value, ',');
+		else if (strcmp(arg, "--list") == 0)
+			someOptionsOut.myListOnly = true;
+		else if (strcmp(arg, "--counters") == 0)
+			someOptionsOut.myUseCounters = true;
+		else if ((value = GetOptionValue(arg, "--warmup")))
+			someOptionsOut.myWarmupCount = std::max(atoi(value), 0);
+		else if ((value = GetOptionValue(arg, "--repetitions")))
+			someOptionsOut.myRepetitionCount = std::max(atoi(value), 1);
+		else if ((value = GetOptionValue(arg, "--cpu")))
+			someOptionsOut.myCpu = atoi(value);
+		else if ((value = GetOptionValue(arg, "--threads")))
+			someOptionsOut.myThreadCount = std::max(atoi(value), 1);
+		else if ((value = GetOptionValue(arg, "--output")))
+			someOptionsOut.myOutputPath = value;
+		else if ((value = GetOptionValue(arg, "--baseline")))
+			someOptionsOut.myBaselinePath = value;
+		else if ((value = GetOptionValue(arg, "--threshold")))
+			someOptionsOut.myRegressionThreshold = atof(value) / 100;
+		else if ((value = GetOptionValue(arg, "--format")) && ParseFormat(value, someOptionsOut.myFormat))
+			continue;
+		else
+		{
+			printf("Unknown argument: %s\n", arg);
+			PrintUsage();
+			return false;
+		}
+	}
+	return true;
+}
+
+BenchmarkThreadPool::BenchmarkThreadPool(size_t aThreadCount, int aFirstCpu)
+	: myFunction(nullptr)
+	, myActiveCount(0)
+	, myPendingCount(0)
+	, myGeneration(0)
+	, myFirstCpu(aFirstCpu)
+	, myIsStopping(false)
+{
+	for (size_t i = 1; i < aThreadCount; ++i)
+		myThreads.emplace_back(&BenchmarkThreadPool::WorkerMain, this, i);
+}
+
+BenchmarkThreadPool::~BenchmarkThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myIsStopping = true;
+	}
+	myStartCondition.notify_all();
+
+	for (std::thread& thread : myThreads)
+		thread.join();
+}
+
+void BenchmarkThreadPool::Run(size_t aThreadCount, const std::function<void(size_t)>& aFunction)
+{
+	aThreadCount = std::min(std::max(aThreadCount, (size_t)1), GetThreadCount());
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myFunction = &aFunction;
+		myActiveCount = aThreadCount;
+		myPendingCount = aThreadCount - 1;
+		++myGeneration;
+	}
+	myStartCondition.notify_all();
+
+	aFunction(0);
+
+	std::unique_lock<std::mutex> lock(myMutex);
+	myDoneCondition.wait(lock, [this]() { return myPendingCount == 0; });
+}
+
+void BenchmarkThreadPool::WorkerMain(size_t anIndex)
+{
+	// Workers inherit the affinity of the thread creating the pool, each one moves to its own core
+	if (myFirstCpu >= 0)
+	{
+		const size_t cpuCount = std::max(std::thread::hardware_concurrency(), 1u);
+		PinThread((int)((myFirstCpu + anIndex) % cpuCount));
+	}
+
+	uint64_t generation = 0;
+	std::unique_lock<std::mutex> lock(myMutex);
+	for (;;)
+	{
+		myStartCondition.wait(lock, [this, generation]() { return myIsStopping || myGeneration != generation; });
+		if (myIsStopping)
+			return;
+
+		generation = myGeneration;
+		if (anIndex >= myActiveCount)
+			continue;
+
+		const std::function<void(size_t)>* function = myFunction;
+		lock.unlock();
+		(*function)(anIndex);
+		lock.lock();
+
+		if (--myPendingCount == 0)
+			myDoneCondition.notify_one();
+	}
+}
+
+int BenchmarkRunner::Run(const BenchmarkOptions& someOptions)
+{
+	using namespace std::chrono;
+
+	std::vector<const Case*> selectedCases;
+	size_t nameWidth = 0;
+	for (const Case& it : myCases)
+	{
+		const bool isSelected = someOptions.myFilters.empty()
+			|| std::any_of(someOptions.myFilters.begin(), someOptions.myFilters.end(),
+				[&it](const std::string& aFilter) { return it.myName.find(aFilter) != std::string::npos; });
+		if (isSelected)
+		{
+			selectedCases.push_back(&it);
+			nameWidth = std::max(nameWidth, it.myName.size());
+		}
+	}
+
+	if (someOptions.myListOnly)
+	{
+		for (const Case* it : selectedCases)
+			printf("%s\n", it->myName.c_str());
+		return 0;
+	}
+
+	std::unordered_map<std::string, double> baselineTimes;
+	if (!someOptions.myBaselinePath.empty() && !LoadBaseline(someOptions.myBaselinePath, baselineTimes))
+		fprintf(stderr, "Could not read the baseline %s\n", someOptions.myBaselinePath.c_str());
+
+	if (someOptions.myCpu >= 0 && !PinThread(someOptions.myCpu))
+		fprintf(stderr, "Could not pin the benchmark thread to cpu %d\n", someOptions.myCpu);
+
+	// Opened before the fixtures create their threads, so that the counters include the worker threads
+	std::unique_ptr<PerfCounters> counters;
+	if (someOptions.myUseCounters)
+	{
+		counters.reset(new PerfCounters());
+		if (!counters->IsAnyAvailable())
+			fprintf(stderr, "Hardware counters are not available, check perf_event_paranoid\n");
+	}
+
+	// Results are printed as they come, unless the standard output receives a CSV or JSON report
+	const bool printProgress = someOptions.myFormat == BenchmarkFormat::Text || !someOptions.myOutputPath.empty();
+
+	std::vector<BenchmarkResult> results;
+	std::vector<double> times(someOptions.myRepetitionCount);
+	BenchmarkFixtureBase* fixture = nullptr;
+	int regressionCount = 0;
+
+	for (const Case* it : selectedCases)
+	{
+		if (it->myFixture != fixture)
+		{
+			if (fixture)
+				fixture->Destroy();
+			fixture = it->myFixture;
+			if (fixture)
+				fixture->Create();
+		}
+
+		for (int i = 0; i < someOptions.myWarmupCount; ++i)
+			it->myFunction();
+
+		size_t itemCount = 0;
+		size_t totalItemCount = 0;
+		if (counters)
+			counters->Start();
+
+		for (double& time : times)
+		{
+			auto before = steady_clock::now();
+
+			itemCount = it->myFunction();
+
+			auto after = steady_clock::now();
+			time = duration<double, std::milli>(after - before).count();
+			totalItemCount += itemCount;
+		}
+
+		if (counters)
+			counters->Stop();
+
+		// Nearest rank percentiles
+		std::sort(times.begin(), times.end());
+		BenchmarkResult result;
+		result.myName = it->myName;
+		result.myItemCount = itemCount;
+		result.myMinTime = times.front();
+		result.myMedianTime = times[(times.size() - 1) / 2];
+		result.myP99Time = times[(times.size() * 99 + 99) / 100 - 1];
+		result.myNote = it->myNoteFunction ? it->myNoteFunction(result.myMedianTime) : std::string();
+
+		auto baseline = baselineTimes.find(it->myName);
+		result.myBaselineMedianTime = baseline != baselineTimes.end() ? baseline->second : -1.0;
+		result.myIsRegression = baseline != baselineTimes.end()
+			&& result.myMedianTime > baseline->second * (1 + someOptions.myRegressionThreshold);
+		regressionCount += result.myIsRegression;
+
+		for (size_t i = 0; i < PerfCounters::theCount; ++i)
+		{
+			const bool isAvailable = counters && counters->IsAvailable((PerfCounter)i) && totalItemCount > 0;
+			const double count = isAvailable ? counters->Get((PerfCounter)i) : -1.0;
+			result.myCounters[i] = count >= 0 ? count / totalItemCount : -1.0;
+		}
+
+		if (printProgress)
+		{
+			PrintTextResult(stdout, result, nameWidth);
+			fflush(stdout);
+		}
+		results.push_back(std::move(result));
+	}
+
+	if (fixture)
+		fixture->Destroy();
+
+	if (!someOptions.myOutputPath.empty())
+	{
+		if (FILE* file = fopen(someOptions.myOutputPath.c_str(), "w"))
+		{
+			WriteReport(file, someOptions.myFormat, results, nameWidth);
+			fclose(file);
+		}
+		else
+			fprintf(stderr, "Could not write the report %s\n", someOptions.myOutputPath.c_str());
+	}
+	else if (!printProgress)
+		WriteReport(stdout, someOptions.myFormat, results, nameWidth);
+
+	if (regressionCount > 0)
+		fprintf(stderr, "%d regressions above %.1f%% against the baseline\n", regressionCount, someOptions.myRegressionThreshold * 100);
+
+	return regressionCount;
+}
+} // namespace KCL_Test
@@ -0,0 +1,209 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Minimal benchmark harness.
+// Cases are registered with a name and a function running one repetition and returning the number of items processed.
+// Each case is first run a few times to warm the caches and the branch predictors, then timed over several repetitions
+// reporting the min, median and 99th percentile, and optionally hardware counters per item. Results are written as
+// text, CSV or JSON, and can be compared with a CSV file saved by a previous run to flag the cases whose median got
+// slower than a threshold.
+// Note:
+// * Cases sharing their input use a fixture, created before the first of these cases runs and destroyed when a case
+//   using another fixture runs, so that only one input is in memory at a time. Cases of a fixture must be consecutive.
+// * Case names are "Group/Case", --filter selects the cases whose name contains one of the comma separated patterns.
+
+/*Usage :
+
+KCL_Test::BenchmarkRunner runner;
+auto objects = runner.AddFixture([]() { return MakeObjects(); });
+runner.AddCase("Objects/Update", objects, [](Objects& someObjects) { Update(someObjects); return someObjects.size(); });
+
+KCL_Test::BenchmarkOptions options;
+if (!KCL_Test::ParseBenchmarkOptions(argc, argv, options))
+	return 1;
+int regressionCount = runner.Run(options);
+
+*/
+
+namespace KCL_Test
+{
+enum class BenchmarkFormat
+{
+	Text,
+	CSV,
+	JSON
+};
+
+struct BenchmarkOptions
+{
+	// Cases whose name contains one of these, all cases if empty
+	std::vector<std::string> myFilters;
+	int myWarmupCount = 1;
+	int myRepetitionCount = 10;
+	// Core the benchmark thread is pinned to, -1 lets the scheduler move it
+	int myCpu = -1;
+	bool myListOnly = false;
+	// Hardware counters per item, where the platform provides them
+	bool myUseCounters = false;
+	BenchmarkFormat myFormat = BenchmarkFormat::Text;
+	// Standard output if empty
+	std::string myOutputPath;
+	// CSV report of a previous run
+	std::string myBaselinePath;
+	// Relative increase of the median flagged as a regression
+	double myRegressionThreshold = 0.05;
+	// Maximum number of threads of the scaling cases
+	int myThreadCount = (int)std::thread::hardware_concurrency();
+};
+
+// Returns false and prints the usage if an argument is not recognized
+bool ParseBenchmarkOptions(int anArgCount, const char* const* someArgs, BenchmarkOptions& someOptionsOut);
+
+// Pins the calling thread to a core, returns false if the platform does not support it
+bool PinThread(int aCpu);
+
+class BenchmarkFixtureBase
+{
+public:
+	virtual ~BenchmarkFixtureBase() {}
+
+	virtual void Create() = 0;
+	virtual void Destroy() = 0;
+};
+
+template<typename T>
+class BenchmarkFixture final : public BenchmarkFixtureBase
+{
+public:
+	explicit BenchmarkFixture(std::function<T()> aFactory)
+		: myFactory(std::move(aFactory))
+	{
+	}
+
+	void Create() override { myData.reset(new T(myFactory())); }
+	void Destroy() override { myData.reset(); }
+
+	T& Get() { return *myData; }
+
+private:
+	std::function<T()> myFactory;
+	std::unique_ptr<T> myData;
+};
+
+// Threads running the same function, for benchmarks of concurrent code.
+// Threads are started once and wait for work, so that thread creation is not measured.
+class BenchmarkThreadPool
+{
+public:
+	// Thread i is pinned to core aFirstCpu + i, none are pinned if aFirstCpu is negative
+	explicit BenchmarkThreadPool(size_t aThreadCount, int aFirstCpu = -1);
+	~BenchmarkThreadPool();
+
+	BenchmarkThreadPool(const BenchmarkThreadPool&) = delete;
+	BenchmarkThreadPool& operator=(const BenchmarkThreadPool&) = delete;
+
+	// Including the calling thread
+	size_t GetThreadCount() const { return myThreads.size() + 1; }
+
+	// Calls aFunction(threadIndex) on aThreadCount threads and returns once they are all done, the calling thread is index 0
+	void Run(size_t aThreadCount, const std::function<void(size_t)>& aFunction);
+
+private:
+	void WorkerMain(size_t anIndex);
+
+	std::vector<std::thread> myThreads;
+	std::mutex myMutex;
+	std::condition_variable myStartCondition;
+	std::condition_variable myDoneCondition;
+	const std::function<void(size_t)>* myFunction;
+	size_t myActiveCount;
+	size_t myPendingCount;
+	uint64_t myGeneration;
+	int myFirstCpu;
+	bool myIsStopping;
+};
+
+class BenchmarkRunner
+{
+public:
+	template<typename Factory>
+	BenchmarkFixture<decltype(std::declval<Factory>()())>* AddFixture(Factory aFactory)
+	{
+		typedef decltype(aFactory()) DataType;
+		BenchmarkFixture<DataType>* fixture = new BenchmarkFixture<DataType>(std::move(aFactory));
+		myFixtures.emplace_back(fixture);
+		return fixture;
+	}
+
+	// aFunction runs one repetition and returns the number of items processed
+	void AddCase(std::string aName, std::function<size_t()> aFunction)
+	{
+		myCases.push_back(Case{std::move(aName), nullptr, std::move(aFunction), nullptr});
+	}
+
+	template<typename T, typename Function>
+	void AddCase(std::string aName, BenchmarkFixture<T>* aFixture, Function aFunction)
+	{
+		std::function<size_t()> function = [aFixture, aFunction]() { return (size_t)aFunction(aFixture->Get()); };
+		myCases.push_back(Case{std::move(aName), aFixture, std::move(function), nullptr});
+	}
+
+	// aNoteFunction(T&, double aMedianTime) describes the case once it ran, for example the memory used by the tested
+	// structure or a throughput derived from the median time in milliseconds
+	template<typename T, typename Function, typename NoteFunction>
+	void AddCase(std::string aName, BenchmarkFixture<T>* aFixture, Function aFunction, NoteFunction aNoteFunction)
+	{
+		AddCase(std::move(aName), aFixture, std::move(aFunction));
+		myCases.back().myNoteFunction = [aFixture, aNoteFunction](double aMedianTime) {
+			return std::string(aNoteFunction(aFixture->Get(), aMedianTime));
+		};
+	}
+
+	// Runs the selected cases and writes the report, returns the number of regressions against the baseline
+	int Run(const BenchmarkOptions& someOptions);
+
+private:
+	struct Case
+	{
+		std::string myName;
+		BenchmarkFixtureBase* myFixture;
+		std::function<size_t()> myFunction;
+		std::function<std::string(double)> myNoteFunction;
+	};
+
+	std::vector<std::unique_ptr<BenchmarkFixtureBase>> myFixtures;
+	std::vector<Case> myCases;
+};
+} // namespace KCL_Test
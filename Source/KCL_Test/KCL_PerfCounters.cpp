@@ -0,0 +1,155 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "KCL_PerfCounters.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+namespace KCL_Test
+{
+#if defined(__linux__)
+namespace
+{
+// Cache events are encoded as cache | (operation << 8) | (result << 16)
+constexpr uint64_t MakeCacheEvent(uint64_t aCache)
+{
+	return aCache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+struct EventDescription
+{
+	uint32_t myType;
+	uint64_t myConfig;
+};
+
+// Same order as PerfCounter
+const EventDescription theEvents[PerfCounters::theCount] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_HW_CACHE, MakeCacheEvent(PERF_COUNT_HW_CACHE_L1D)},
+	{PERF_TYPE_HW_CACHE, MakeCacheEvent(PERF_COUNT_HW_CACHE_LL)},
+	{PERF_TYPE_HW_CACHE, MakeCacheEvent(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+int OpenEvent(const EventDescription& anEvent)
+{
+	perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = anEvent.myType;
+	attributes.config = anEvent.myConfig;
+	attributes.disabled = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	// Threads created afterwards count into the same event, reads and ioctls apply to them too
+	attributes.inherit = 1;
+	attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	// Calling thread and its future threads, any cpu, no group
+	return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+} // namespace
+#endif
+
+PerfCounters::PerfCounters()
+{
+	for (size_t i = 0; i < theCount; ++i)
+	{
+#if defined(__linux__)
+		myFileDescriptors[i] = OpenEvent(theEvents[i]);
+#else
+		myFileDescriptors[i] = -1;
+#endif
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+	for (int fileDescriptor : myFileDescriptors)
+		if (fileDescriptor >= 0)
+			close(fileDescriptor);
+#endif
+}
+
+const char* PerfCounters::GetName(PerfCounter aCounter)
+{
+	static const char* const theNames[theCount] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses"};
+	return theNames[(size_t)aCounter];
+}
+
+bool PerfCounters::IsAnyAvailable() const
+{
+	for (int fileDescriptor : myFileDescriptors)
+		if (fileDescriptor >= 0)
+			return true;
+	return false;
+}
+
+void PerfCounters::Start()
+{
+#if defined(__linux__)
+	for (int fileDescriptor : myFileDescriptors)
+	{
+		if (fileDescriptor >= 0)
+		{
+			ioctl(fileDescriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fileDescriptor, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+}
+
+void PerfCounters::Stop()
+{
+#if defined(__linux__)
+	for (int fileDescriptor : myFileDescriptors)
+		if (fileDescriptor >= 0)
+			ioctl(fileDescriptor, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+double PerfCounters::Get(PerfCounter aCounter) const
+{
+#if defined(__linux__)
+	const int fileDescriptor = myFileDescriptors[(size_t)aCounter];
+	uint64_t values[3]; // Count, time enabled, time running
+	if (fileDescriptor < 0 || read(fileDescriptor, values, sizeof(values)) != sizeof(values) || values[2] == 0)
+		return -1.0;
+
+	// Scales multiplexed counters to the whole time they were enabled
+	return (double)values[0] * ((double)values[1] / (double)values[2]);
+#else
+	(void)aCounter;
+	return -1.0;
+#endif
+}
+} // namespace KCL_Test
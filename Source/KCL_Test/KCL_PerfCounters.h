@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright(c) 2019 Samuel Kahn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+
+// Hardware performance counters of the calling thread, read with perf_event_open on Linux.
+// Each counter is opened on its own, a counter the processor or the kernel does not provide is unavailable while the
+// others keep working. When there are more counters than hardware registers the kernel multiplexes them, counts are
+// scaled by the fraction of time each counter was actually running.
+// Note:
+// * Counters are unavailable on other platforms, and on Linux when perf_event_paranoid forbids user space counting.
+// * Only user space events are counted.
+// * Threads created by the calling thread after the constructor are counted with it, earlier threads are not.
+
+/*Usage :
+
+KCL_Test::PerfCounters counters;
+counters.Start();
+Work();
+counters.Stop();
+
+if (counters.IsAvailable(KCL_Test::PerfCounter::BranchMisses))
+	printf("%f\n", counters.Get(KCL_Test::PerfCounter::BranchMisses));
+
+*/
+
+namespace KCL_Test
+{
+enum class PerfCounter
+{
+	Cycles,
+	Instructions,
+	BranchMisses,
+	L1DMisses,
+	LLCMisses,
+	DTLBMisses,
+	Count
+};
+
+class PerfCounters
+{
+public:
+	static constexpr size_t theCount = (size_t)PerfCounter::Count;
+
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	static const char* GetName(PerfCounter aCounter);
+
+	bool IsAvailable(PerfCounter aCounter) const { return myFileDescriptors[(size_t)aCounter] >= 0; }
+	bool IsAnyAvailable() const;
+
+	// Resets and enables the available counters
+	void Start();
+	void Stop();
+
+	// Events counted between Start and Stop, negative if the counter is unavailable, failed to read or was never scheduled
+	double Get(PerfCounter aCounter) const;
+
+private:
+	int myFileDescriptors[theCount];
+};
+} // namespace KCL_Test
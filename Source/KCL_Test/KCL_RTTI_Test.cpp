@@ -22,12 +22,32 @@
 
 #include "KCL_RTTI_Test.h"
 
+#include <algorithm>
 #include <cassert>
-#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "KCL/KCL_PolyCollection.h"
 #include "KCL/KCL_RTTI.h"
+#include "KCL/KCL_RTTI_Archive.h"
+#include "KCL/KCL_RTTI_Batch.h"
+#include "KCL/KCL_RTTI_CastCache.h"
+#include "KCL/KCL_RTTI_CastMatrix.h"
+#include "KCL/KCL_RTTI_Dispatcher.h"
+#include "KCL/KCL_RTTI_EventBus.h"
+#include "KCL/KCL_RTTI_Factory.h"
+#include "KCL/KCL_RTTI_Fields.h"
+#include "KCL/KCL_RTTI_Match.h"
+#include "KCL/KCL_RTTI_Profile.h"
+#include "KCL/KCL_RTTI_Registry.h"
+#include "KCL/KCL_RTTI_Serialization.h"
+#include "KCL/KCL_RTTI_TypeMap.h"
+#include "KCL_Benchmark.h"
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -47,6 +67,14 @@
 	};                                                                                                                                     \
 	KCL_EXPAND(KCL_RTTI_REGISTER(CLASS, __VA_ARGS__))
 
+#define FINAL_CLASS(CLASS, ...)                                                                                                            \
+	struct CLASS final : __VA_ARGS__                                                                                                       \
+	{                                                                                                                                      \
+		KCL_RTTI_IMPL() virtual ~CLASS() {}                                                                                                \
+		int myInt##CLASS;                                                                                                                  \
+	};                                                                                                                                     \
+	KCL_EXPAND(KCL_RTTI_REGISTER(CLASS, __VA_ARGS__))
+
 // Single inheritance hierarchies
 
 BASE_CLASS(Base1)
@@ -132,6 +160,81 @@ DERIVED_CLASS(Multi4C, Multi1C, Multi2C, Multi3C)
 DERIVED_CLASS(Multi5C, Multi2C, Multi3C, Multi1C)
 DERIVED_CLASS(Multi6C, Multi3C, Multi1C, Multi2C)
 
+// Leaf types
+FINAL_CLASS(Final7A, Derived7A)
+FINAL_CLASS(FinalMulti1A, Multi1A)
+
+// Reflected fields, declared before and after the registration of the type, including fields of a secondary base
+struct Item : public Base1
+{
+	KCL_RTTI_IMPL()
+	virtual ~Item() {}
+	int myCount;
+	const float myWeight = 1.0f;
+	Derived1A myComponent;
+	Base2* myOwner;
+};
+KCL_RTTI_FIELDS(Item, myCount, myWeight, myComponent, myOwner, myIntBase1)
+KCL_RTTI_REGISTER(Item, Base1)
+
+KCL_RTTI_FIELDS(Multi1A, myIntMulti1A, myIntBase1, myIntBase2)
+KCL_RTTI_FIELDS(Multi7B, myIntMulti7B, myIntDerived7A, myIntDerived7F)
+
+// Serialized types, with trivial fields, nested objects, arrays and pointers to polymorphic types
+struct Vector3
+{
+	float myX;
+	float myY;
+	float myZ;
+};
+
+struct Shape
+{
+	KCL_RTTI_IMPL()
+	virtual ~Shape() {}
+	Vector3 myPosition = {0, 0, 0};
+	int myLayer = 0;
+};
+KCL_RTTI_REGISTER(Shape)
+KCL_RTTI_FIELDS(Shape, myPosition, myLayer)
+
+struct Circle : public Shape
+{
+	KCL_RTTI_IMPL()
+	float myRadius = 0;
+};
+KCL_RTTI_REGISTER(Circle, Shape)
+KCL_RTTI_FIELDS(Circle, myPosition, myLayer, myRadius)
+
+struct Group : public Shape
+{
+	KCL_RTTI_IMPL()
+	~Group()
+	{
+		delete myFirst;
+		delete mySecond;
+	}
+	Shape* myFirst = nullptr;
+	Base2* mySecond = nullptr;
+	Circle myBounds;
+	uint8_t myFlags[4] = {};
+};
+KCL_RTTI_REGISTER(Group, Shape)
+KCL_RTTI_FIELDS(Group, myPosition, myLayer, myFirst, mySecond, myBounds, myFlags)
+
+// Does not own the next link, counts the live links
+struct Link : public Shape
+{
+	KCL_RTTI_IMPL()
+	Link() { ++ourLiveCount; }
+	~Link() { --ourLiveCount; }
+	static inline int ourLiveCount = 0;
+	Link* myNext = nullptr;
+	int myIndex = 0;
+};
+KCL_RTTI_REGISTER(Link, Shape)
+KCL_RTTI_FIELDS(Link, myPosition, myLayer, myNext, myIndex)
+
 //////////////////////////////////////////////////////////////////////////
 
 namespace KCL_Test
@@ -150,6 +253,71 @@ class Forward
 	int i;
 };
 
+// Single call site shared by all the casts of a given type pair
+template<typename Derived, typename Base>
+Derived* CachedCast(Base* aBasePtr)
+{
+	return KCL_CACHED_DYNAMIC_CAST(Derived*, aBasePtr);
+}
+
+template<typename... Types>
+void CheckScanModesAgree(const KCL::RTTI::TypeInfo* aTypeInfo)
+{
+	using namespace KCL::RTTI;
+
+	const intptr_t dummyPtr = 0x1000;
+	auto check = [&](typeId_t aTypeId, typeId_t aDepth) {
+		assert(aTypeInfo->CastTo<TypeIdScan::Scalar>(dummyPtr, aTypeId, aDepth)
+			== aTypeInfo->CastTo<TypeIdScan::SIMD>(dummyPtr, aTypeId, aDepth));
+		assert(aTypeInfo->CastTo<TypeIdScan::Scalar>(dummyPtr, aTypeId) == aTypeInfo->CastTo<TypeIdScan::SIMD>(dummyPtr, aTypeId));
+	};
+	(check(GetTypeId<Types>(), GetTypeDepth<Types>()), ...);
+}
+
+// Pair handlers of the double dispatch, they return their number and record their arguments
+static const void* theDispatchedFirst = nullptr;
+static const void* theDispatchedSecond = nullptr;
+
+template<int Number, typename TypeA, typename TypeB>
+int HandlePair(TypeA* aFirst, TypeB* aSecond)
+{
+	theDispatchedFirst = aFirst;
+	theDispatchedSecond = aSecond;
+	return Number;
+}
+
+// The same dispatch as nested casts, most specific first type first
+int DispatchPairByCasts(Base1* aFirst, Base1* aSecond)
+{
+	if (Multi1A* first = kcl_dynamic_cast<Multi1A*>(aFirst))
+	{
+		if (Derived1B* second = kcl_dynamic_cast<Derived1B*>(aSecond))
+			return HandlePair<5>(first, second);
+	}
+	else if (Derived1A* first = kcl_dynamic_cast<Derived1A*>(aFirst))
+	{
+		if (Derived1B* second = kcl_dynamic_cast<Derived1B*>(aSecond))
+			return HandlePair<3>(first, second);
+		return HandlePair<2>(first, aSecond);
+	}
+	else if (Derived2B* first = kcl_dynamic_cast<Derived2B*>(aFirst))
+	{
+		if (Derived1A* second = kcl_dynamic_cast<Derived1A*>(aSecond))
+			return HandlePair<4>(first, second);
+	}
+	return HandlePair<1>(aFirst, aSecond);
+}
+
+// Same handlers as DispatchPairByCasts
+void AddPairHandlers(KCL::RTTI::Dispatcher2<Base1, Base1, int>& aDispatcher)
+{
+	aDispatcher.Add<&HandlePair<1, Base1, Base1>>();
+	aDispatcher.Add<&HandlePair<2, Derived1A, Base1>>();
+	aDispatcher.Add<&HandlePair<3, Derived1A, Derived1B>>();
+	aDispatcher.Add<&HandlePair<4, Derived2B, Derived1A>>();
+	aDispatcher.Add<&HandlePair<5, Multi1A, Derived1B>>();
+}
+
 void RTTI_Test()
 {
 	using namespace KCL::RTTI;
@@ -157,6 +325,25 @@ void RTTI_Test()
 	assert(GetTypeId<Derived1A>() != GetTypeId<Base1>());
 	assert(GetTypeInfo<Derived1A>() != GetTypeInfo<Base1>());
 
+	// Names are the registered type, not the registration macro arguments
+	assert(strcmp(GetTypeInfo<Base1>()->GetName(), "Base1") == 0);
+	assert(strcmp(GetTypeInfo<Multi1A>()->GetName(), "Multi1A") == 0);
+
+	// Static and dynamic type ids must agree
+	assert(GetTypeInfo<Multi4C>()->GetTypeId() == GetTypeId<Multi4C>());
+	assert(GetTypeInfo<Forward>()->GetTypeId() == GetTypeId<Forward>());
+
+#if KCL_RTTI_HASHED_TYPEID
+	// Hashed ids are constant expressions derived from the registered name
+	static_assert(GetTypeId<Base1>() == HashTypeName("Base1"), "Type id must be the hash of the registered name");
+	static_assert(GetTypeId<const Forward&>() == HashTypeName("KCL_Test::Forward"), "Type id must be the hash of the registered name");
+	// The whole type data is a constant expression
+	static_assert(KCL::RTTI_Private::GetTypeInfo<Derived7A>::ourInstance.myData.myBuffer[1] == GetTypeId<Derived7A>(),
+				  "Type data must be built at compile time");
+	static_assert(KCL::RTTI_Private::GetTypeInfo<Derived7A>::ourInstance.myData.myBuffer[0] == GetTypeDepth<Derived7A>() + 1,
+				  "Type data must be built at compile time");
+#endif
+
 	// Testing type info validity with modifiers
 	assert(GetTypeInfo<Forward>() == GetTypeInfo<const Forward>());
 	assert(GetTypeInfo<Forward>() == GetTypeInfo<volatile Forward>());
@@ -182,6 +369,25 @@ void RTTI_Test()
 		assert(&der7 == base && base == der && base == der2 && base == der6);
 	}
 
+	{
+		// Depth is the length of the primary chain, multiple inheritance follows the first base
+		static_assert(GetTypeDepth<Base1>() == 0, "Root types have depth 0");
+		static_assert(GetTypeDepth<Derived7A>() == 7, "Depth follows the inheritance chain");
+		static_assert(GetTypeDepth<Multi7A>() == 7, "Depth follows the first base");
+		static_assert(GetTypeDepth<Multi4C>() == 2, "Depth follows the first base");
+		assert(GetTypeInfo<Derived7A>()->GetDepth() == 7);
+		assert(GetTypeInfo<Multi4C>()->GetDepth() == 2);
+
+		// Primary chain casts must match the full walk, including failed casts across sibling chains
+		Derived7A der7;
+		const TypeInfo* info = der7.KCL_RTTI_GetTypeInfo();
+		assert(info->CastTo(1, GetTypeId<Derived4A>(), GetTypeDepth<Derived4A>()) == 1);
+		assert(info->CastTo(1, GetTypeId<Derived4A>()) == 1);
+		assert(info->CastTo(1, GetTypeId<Derived4B>(), GetTypeDepth<Derived4B>()) == 0);
+		assert(info->CastTo(1, GetTypeId<Derived4B>()) == 0);
+		assert(!kcl_dynamic_cast<Multi7A*>(static_cast<Base1*>(&der7)));
+	}
+
 	{
 		// confirm dynamic cast is working in multiple inheritance scenario
 		Multi5A m;
@@ -305,863 +511,1885 @@ void RTTI_Test()
 		assert(!forwardDyn);
 	}
 
-	// Note: this will result in ambiguous conversion which is expected
-	// Multi7B m;
-	// Base1* base1dyn = kcl_dynamic_cast<Base1*>(&m);
-}
-
-static int validCastCounter = 0;
-
-template<typename Derived, typename T>
-KCL_NOINLINE void RunDynamicCastTest(const std::vector<std::shared_ptr<T>>& testVector, int loopCount)
-{
-	for (int i = 0; i < loopCount; i++)
 	{
-		for (const auto& it : testVector)
-		{
-			Derived* result = dynamic_cast<Derived*>(it.get());
-			if (result)
-				validCastCounter++;
-		}
+		// Exact type checks and casts to final types are a single compare
+		Final7A final7A;
+		FinalMulti1A finalMulti1A;
+		Derived7A der7A;
+		Base1* final7AAsBase = &final7A;
+		Base2* finalMulti1AAsBase2 = &finalMulti1A;
+
+		assert(IsExactly<Final7A>(final7AAsBase));
+		assert(!IsExactly<Derived7A>(final7AAsBase));
+		assert(!IsExactly<Final7A>((Base1*)nullptr));
+		assert(ExactCast<Final7A*>(final7AAsBase) == &final7A);
+		assert(ExactCast<Derived7A*>(final7AAsBase) == nullptr);
+		assert(ExactCast<Derived7A*>(static_cast<Base1*>(&der7A)) == &der7A);
+		assert(ExactCast<Final7A*>(finalMulti1AAsBase2) == nullptr);
+
+		assert(kcl_dynamic_cast<Final7A*>(final7AAsBase) == &final7A);
+		assert(kcl_dynamic_cast<Final7A*>(static_cast<Base1*>(&der7A)) == nullptr);
+		assert(kcl_dynamic_cast<Final7A*>(finalMulti1AAsBase2) == nullptr);
+		assert(kcl_dynamic_cast<FinalMulti1A*>(finalMulti1AAsBase2) == &finalMulti1A);
+		assert(kcl_dynamic_cast<FinalMulti1A*>(static_cast<Base1*>(&finalMulti1A)) == &finalMulti1A);
+		assert(kcl_dynamic_cast<FinalMulti1A*>((Base2*)nullptr) == nullptr);
+		assert(kcl_dynamic_cast<Base2*>(final7AAsBase) == nullptr);
+		assert(kcl_dynamic_cast<Base2*>(static_cast<Base1*>(&finalMulti1A)) == static_cast<Base2*>(&finalMulti1A));
+
+		// Ambiguous base, the exact cast goes through the type data
+		Multi7B m7B;
+		Base1* m7BAsBase = static_cast<Derived7A*>(&m7B);
+		assert(ExactCast<Multi7B*>(m7BAsBase) == &m7B);
 	}
-}
 
-template<typename Derived, typename T>
-KCL_NOINLINE void RunKCLCastTest(const std::vector<std::shared_ptr<T>>& testVector, int loopCount)
-{
-	for (int i = 0; i < loopCount; i++)
 	{
-		for (const auto& it : testVector)
+		// Cast matrix over the nested multiple inheritance set, casts read offsets from the dynamic type row
+		const CastMatrix matrix({GetTypeInfo<Base1>(), GetTypeInfo<Base2>(), GetTypeInfo<Base3>(), GetTypeInfo<Base4>(),
+									GetTypeInfo<Base5>(), GetTypeInfo<Base6>()},
+			64 * 1024);
+		assert(matrix.Contains(GetTypeInfo<Multi4C>()) && matrix.Contains(GetTypeInfo<Base6>()));
+		assert(!matrix.Contains(GetTypeInfo<Forward>()));
+		assert(matrix.GetByteSize() <= 64 * 1024);
+
+		Multi4C m4C;
+		Multi5C m5C;
+		Base1* m4CAsBase1 = &m4C;
+		Base4* m5CAsBase4 = &m5C;
+		assert(matrix.Cast<Multi4C*>(m4CAsBase1) == &m4C);
+		assert(matrix.Cast<Base4*>(m4CAsBase1) == static_cast<Base4*>(&m4C));
+		assert(matrix.Cast<Multi3C*>(m4CAsBase1) == static_cast<Multi3C*>(&m4C));
+		assert(matrix.Cast<Multi5C*>(m4CAsBase1) == nullptr);
+		assert(matrix.Cast<Multi5C*>(m5CAsBase4) == &m5C);
+		assert(matrix.Cast<Base1*>(m5CAsBase4) == static_cast<Base1*>(&m5C));
+		assert(matrix.Cast<Base6*>(m5CAsBase4) == static_cast<Base6*>(&m5C));
+		assert(matrix.Cast<Multi4C*>((Base1*)nullptr) == nullptr);
+
+		// Outside of the matrix and ambiguous bases fall back to the dynamic cast
+		assert(matrix.Cast<Forward*>(m4CAsBase1) == nullptr);
+		Multi1B m1B;
+		Base1* m1BAsBase1 = static_cast<Derived1B*>(&m1B);
+		assert(matrix.Cast<Multi1B*>(m1BAsBase1) == &m1B);
+		assert(matrix.Cast<Derived1E*>(m1BAsBase1) == static_cast<Derived1E*>(&m1B));
+
+		// A matrix over budget holds fewer types and still casts correctly
+		const CastMatrix smallMatrix({GetTypeInfo<Base1>()}, 256);
+		assert(smallMatrix.GetByteSize() <= 256);
+		assert(smallMatrix.Cast<Base4*>(m4CAsBase1) == static_cast<Base4*>(&m4C));
+		assert(smallMatrix.Cast<Multi4C*>(m4CAsBase1) == &m4C);
+
+		// Columns resolved for a pair of types by one matrix are not used by another
+		for (int loop = 0; loop < 3; loop++)
 		{
-			Derived* result = kcl_dynamic_cast<Derived*>(it.get());
-			if (result)
-				validCastCounter++;
+			assert(smallMatrix.Cast<Base6*>(m5CAsBase4) == static_cast<Base6*>(&m5C));
+			assert(matrix.Cast<Base6*>(m5CAsBase4) == static_cast<Base6*>(&m5C));
 		}
 	}
-}
 
-void RTTI_Benchmark()
-{
-	using namespace std;
-	using namespace chrono;
-
-	static const int iterations = 1000000;
-	static const int loopCount = 10;
-
-	validCastCounter = 0;
-
-	// One level deep single inheritance hierarchies
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Derived1A>());
-			testObjects.emplace_back(make_shared<Derived1B>());
-			testObjects.emplace_back(make_shared<Derived1C>());
-		}
-
-		// Upcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 1 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 1 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Downcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Derived1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 1 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Downcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Derived1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 1 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+		// Vectorized and scalar scans must agree, wide multiple inheritance has the longest blocks
+		const TypeInfo* multi7B = GetTypeInfo<Multi7B>();
+		CheckScanModesAgree<Base1, Base2, Derived1A, Derived7A, Derived3B, Derived7B, Derived7C, Derived5D, Derived7E, Derived7F,
+			Multi7A, Multi7B, Forward>(multi7B);
+		CheckScanModesAgree<Base1, Base2, Base3, Base4, Base5, Base6, Multi1C, Multi2C, Multi3C, Multi4C, Multi5C>(
+			GetTypeInfo<Multi6C>());
+
+		Multi7B m;
+		Derived7F* der7F = static_cast<Derived7F*>(&m);
+		assert(multi7B->CastTo<TypeIdScan::SIMD>((intptr_t)&m, GetTypeId<Derived7F>(), GetTypeDepth<Derived7F>()) == (intptr_t)der7F);
+		assert(multi7B->CastTo<TypeIdScan::Scalar>((intptr_t)&m, GetTypeId<Derived7F>(), GetTypeDepth<Derived7F>()) == (intptr_t)der7F);
 	}
 
-	// Three level deep single inheritance hierarchies
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Derived3A>());
-			testObjects.emplace_back(make_shared<Derived3B>());
-			testObjects.emplace_back(make_shared<Derived3C>());
-		}
-
-		// Upcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 3 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 3 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Downcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Derived3A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 3 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Downcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Derived3A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 3 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+		// Fields are listed in declaration order with their offset in the object, size and type info if registered
+		Item item;
+		const FieldList& fields = GetTypeInfo<Item>()->GetFields();
+		assert(fields.GetCount() == 5);
+		assert(strcmp(fields.begin()->myName, "myCount") == 0);
+		for (const FieldInfo& field : fields)
+			assert(fields.Find(field.myName) == &field);
+		assert(fields.Find("myIntBase2") == nullptr);
+
+		auto getOffset = [](const void* anObject, const void* aMember) { return (uint32_t)((const char*)aMember - (const char*)anObject); };
+		assert(fields.Find("myWeight")->myOffset == getOffset(&item, &item.myWeight));
+		assert(fields.Find("myWeight")->mySize == sizeof(float));
+		assert(fields.Find("myWeight")->GetTypeInfo() == nullptr);
+		assert(fields.Find("myComponent")->myOffset == getOffset(&item, &item.myComponent));
+		assert(fields.Find("myComponent")->mySize == sizeof(Derived1A));
+		assert(fields.Find("myComponent")->GetTypeInfo() == GetTypeInfo<Derived1A>());
+		assert(fields.Find("myWeight")->myKind == FieldKind::Trivial);
+		assert(fields.Find("myComponent")->myKind == FieldKind::Object);
+
+		// Pointer fields have the type info of the type pointed to
+		assert(fields.Find("myOwner")->GetTypeInfo() == GetTypeInfo<Base2>());
+		assert(fields.Find("myOwner")->myKind == FieldKind::Pointer);
+		item.myOwner = nullptr;
+		const TypeInfo* pointeeTypeInfo = nullptr;
+		assert(fields.Find("myOwner")->GetPointee((intptr_t)&item, pointeeTypeInfo) == 0);
+		Multi1A owner;
+		item.myOwner = &owner;
+		assert(fields.Find("myOwner")->GetPointee((intptr_t)&item, pointeeTypeInfo) == (intptr_t)&owner);
+		assert(pointeeTypeInfo == GetTypeInfo<Multi1A>());
+		assert(fields.Find("myIntBase1")->myOffset == getOffset(&item, &item.myIntBase1));
+
+		// Offsets are from the most derived type, through the secondary base
+		Multi1A m1A;
+		const FieldList& multiFields = GetTypeInfo<Multi1A>()->GetFields();
+		assert(multiFields.GetCount() == 3);
+		assert(multiFields.Find("myIntBase2")->myOffset == getOffset(&m1A, &m1A.myIntBase2));
+		assert(multiFields.Find("myIntMulti1A")->myOffset == getOffset(&m1A, &m1A.myIntMulti1A));
+
+		// Fields are not inherited
+		assert(GetTypeInfo<Base1>()->GetFields().GetCount() == 0);
+		assert(GetTypeInfo<FinalMulti1A>()->GetFields().GetCount() == 0);
+
+		// Runs are in offset order, adjacent trivial fields are merged
+		const FieldList& circleFields = GetTypeInfo<Circle>()->GetFields();
+		assert(circleFields.myRunCount == 1);
+		assert(circleFields.GetRunsBegin()->myField == nullptr);
+		assert(circleFields.GetRunsBegin()->mySize == sizeof(Vector3) + sizeof(int) + sizeof(float));
+		const FieldList& groupFields = GetTypeInfo<Group>()->GetFields();
+		assert(groupFields.myRunCount == 5);
+		assert(groupFields.GetRunsBegin()[1].myField == groupFields.Find("myFirst"));
+		assert(groupFields.GetRunsBegin()[3].myField == groupFields.Find("myBounds"));
+		assert(groupFields.GetRunsBegin()[4].mySize == 4);
 	}
 
-	// Seven level deep single inheritance hierarchies
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Derived7A>());
-			testObjects.emplace_back(make_shared<Derived7B>());
-			testObjects.emplace_back(make_shared<Derived7C>());
-		}
-
-		// Upcast std
+		// Objects are rebuilt with their dynamic type, through pointers to primary and secondary bases
+		Group group;
+		group.myPosition = {1, 2, 3};
+		group.myLayer = 4;
+		group.myBounds.myRadius = 5;
+		group.myFlags[3] = 6;
+		Circle* circle = new Circle();
+		circle->myRadius = 7;
+		group.myFirst = circle;
+		Multi1A* multi = new Multi1A();
+		multi->myIntBase1 = 8;
+		multi->myIntBase2 = 9;
+		multi->myIntMulti1A = 10;
+		group.mySecond = multi;
+
+		Vector3 vectors[3] = {{1, 1, 1}, {2, 2, 2}, {3, 3, 3}};
+
+		BinaryWriter writer;
+		writer.Write<uint8_t>(1);
+		writer.WriteArray(vectors, 3);
+		writer.WritePolymorphic<Shape>(&group);
+		writer.WritePolymorphic<Shape>(nullptr);
+		writer.Write(*circle);
+
+		BinaryReader reader(writer.GetData(), writer.GetSize());
+		uint8_t header = 0;
+		assert(reader.Read(header) && header == 1);
+		size_t vectorCount = 0;
+		const Vector3* readVectors = reader.ReadArrayInPlace<Vector3>(vectorCount);
+		assert(vectorCount == 3 && readVectors[2].myY == 3);
+		assert((const uint8_t*)readVectors > writer.GetData() && (const uint8_t*)readVectors < writer.GetData() + writer.GetSize());
+
+		Shape* shape = reader.ReadPolymorphic<Shape>();
+		Group* readGroup = kcl_dynamic_cast<Group*>(shape);
+		assert(readGroup && readGroup->myPosition.myZ == 3 && readGroup->myLayer == 4);
+		assert(readGroup->myBounds.myRadius == 5 && readGroup->myFlags[3] == 6);
+		assert(readGroup->myFirst->KCL_RTTI_GetTypeInfo() == GetTypeInfo<Circle>());
+		assert(static_cast<Circle*>(readGroup->myFirst)->myRadius == 7);
+		Multi1A* readMulti = kcl_dynamic_cast<Multi1A*>(readGroup->mySecond);
+		assert(readMulti && readMulti->myIntBase1 == 8 && readMulti->myIntBase2 == 9 && readMulti->myIntMulti1A == 10);
+		assert(reader.ReadPolymorphic<Shape>() == nullptr);
+		Circle readCircle;
+		assert(reader.Read(readCircle) && readCircle.myRadius == 7);
+		assert(reader.IsValid() && reader.GetRemainingSize() == 0);
+		delete shape;
+
+		// Arrays are copied out as well
+		BinaryReader arrayReader(writer.GetData(), writer.GetSize());
+		std::vector<Vector3> vectorCopies;
+		assert(arrayReader.Read(header) && arrayReader.ReadArray(vectorCopies));
+		assert(vectorCopies.size() == 3 && vectorCopies[0].myX == 1);
+
+		// An object of another type is not read
+		BinaryReader wrongTypeReader(writer.GetData(), writer.GetSize());
+		wrongTypeReader.Read(header);
+		wrongTypeReader.ReadArray(vectorCopies);
+		assert(wrongTypeReader.ReadPolymorphic<Base3>() == nullptr && !wrongTypeReader.IsValid());
+
+		// Truncated data invalidates the reader, objects rebuilt until then are released
+		BinaryReader truncatedReader(writer.GetData(), writer.GetSize() - sizeof(Circle::myRadius) - 1);
+		truncatedReader.Read(header);
+		truncatedReader.ReadArray(vectorCopies);
+		shape = truncatedReader.ReadPolymorphic<Shape>();
+		assert(shape && truncatedReader.IsValid());
+		delete shape;
+		assert(!truncatedReader.Read(readCircle) && !truncatedReader.IsValid());
+		assert(!truncatedReader.Read(header));
+
+		BinaryWriter groupWriter;
+		groupWriter.WritePolymorphic<Shape>(&group);
+		for (size_t size = 0; size < groupWriter.GetSize(); ++size)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 7 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			BinaryReader partialReader(groupWriter.GetData(), size);
+			assert(partialReader.ReadPolymorphic<Shape>() == nullptr && !partialReader.IsValid());
 		}
 
-		// Upcast kcl
+		// Also when the type does not own the objects it points to
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 7 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Downcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Derived7A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 7 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			Link links[3];
+			links[0].myNext = &links[1];
+			links[1].myNext = &links[2];
+			BinaryWriter linkWriter;
+			linkWriter.WritePolymorphic<Shape>(&links[0]);
+			for (size_t size = 0; size < linkWriter.GetSize(); ++size)
+			{
+				BinaryReader partialReader(linkWriter.GetData(), size);
+				assert(partialReader.ReadPolymorphic<Shape>() == nullptr && Link::ourLiveCount == 3);
+			}
 		}
 
-		// Downcast kcl
+		// Registered types without fields would be read as nothing
+		BinaryWriter noFieldsWriter;
+		const char* noFieldsName = GetTypeInfo<Derived1A>()->GetName();
+		noFieldsWriter.Write<uint32_t>(1);
+		noFieldsWriter.Write<uint32_t>((uint32_t)strlen(noFieldsName));
+		noFieldsWriter.WriteBytes(noFieldsName, strlen(noFieldsName));
+		BinaryReader noFieldsReader(noFieldsWriter.GetData(), noFieldsWriter.GetSize());
+		assert(noFieldsReader.ReadPolymorphic<Base1>() == nullptr && !noFieldsReader.IsValid());
+
+		// Written through a base present several times in the type, from a subobject other than the first one.
+		// Types are named once, the second object refers to the first name.
+		Multi7B multi7B;
+		multi7B.myIntMulti7B = 11;
+		multi7B.myIntDerived7A = 12;
+		multi7B.myIntDerived7F = 13;
+		BinaryWriter multiWriter;
+		multiWriter.WritePolymorphic<Base2>(static_cast<Derived7F*>(&multi7B));
+		const size_t firstSize = multiWriter.GetSize();
+		multiWriter.WritePolymorphic<Base1>(static_cast<Derived7B*>(&multi7B));
+		assert(multiWriter.GetSize() - firstSize == firstSize - strlen("Multi7B") - sizeof(uint32_t));
+		BinaryReader multiReader(multiWriter.GetData(), multiWriter.GetSize());
+		for (int i = 0; i < 2; i++)
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Derived7A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Single inheritance, 7 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			Multi7B* readMulti7B = multiReader.ReadPolymorphic<Multi7B>();
+			assert(readMulti7B && readMulti7B->myIntMulti7B == 11);
+			assert(readMulti7B->myIntDerived7A == 12 && readMulti7B->myIntDerived7F == 13);
+			delete readMulti7B;
 		}
+		assert(multiReader.IsValid() && multiReader.GetRemainingSize() == 0);
 	}
 
-	// Wrong cast, one level deep
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Derived1A>());
-			testObjects.emplace_back(make_shared<Derived1B>());
-			testObjects.emplace_back(make_shared<Derived1C>());
-		}
-
-		// Upcast std
+		// Each pair is handled by the most specific handler, with the arguments cast to its types
+		Dispatcher2<Base1, Base1, int> dispatcher;
+		AddPairHandlers(dispatcher);
+		const size_t base1Count = std::count_if(TypeRegistry::GetInstance().begin(), TypeRegistry::GetInstance().end(),
+			[](const TypeInfo* aTypeInfo) { return aTypeInfo->CastTo(0x1000, GetTypeId<Base1>()) != 0; });
+		assert(dispatcher.GetRowCount() == base1Count && dispatcher.GetColumnCount() == base1Count);
+
+		Base1 base1;
+		Derived1A d1A;
+		Derived3A d3A;
+		Derived1B d1B;
+		Derived3B d3B;
+		Derived1C d1C;
+		Multi1A m1A;
+		Multi3B m3B;
+		Final7A f7A;
+		// Base1 is present several times in Multi3B, the offsets of its arguments depend on the subobject
+		Base1* objects[] = {&base1, &d1A, &d3A, &d1B, &d3B, &d1C, &m1A, static_cast<Derived3A*>(&m3B), static_cast<Derived3B*>(&m3B), &f7A};
+		for (Base1* first : objects)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Wrong cast, 1 level deep. STD i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
+			for (Base1* second : objects)
+			{
+				const int expected = DispatchPairByCasts(first, second);
+				const void* expectedFirst = theDispatchedFirst;
+				const void* expectedSecond = theDispatchedSecond;
+				assert(dispatcher.Dispatch(first, second) == expected);
+				assert(theDispatchedFirst == expectedFirst && theDispatchedSecond == expectedSecond);
+			}
 		}
+		assert(dispatcher.Dispatch(static_cast<Derived3B*>(&m3B), &d1A) == 2 && theDispatchedFirst == static_cast<Derived1A*>(&m3B));
+
+		// Pairs without a handler, and handlers added or replaced once the table is built
+		Dispatcher2<Base1, Base1, int> partialDispatcher;
+		partialDispatcher.Add<&HandlePair<3, Derived1A, Derived1B>>();
+		assert(partialDispatcher.Dispatch(&d3A, &d3B) == 3 && partialDispatcher.Dispatch(&d3B, &d3A) == 0);
+		partialDispatcher.Add<&HandlePair<6, Derived3A, Derived1B>>();
+		partialDispatcher.Add<&HandlePair<7, Derived1A, Derived1B>>();
+		assert(partialDispatcher.Dispatch(&d3A, &d3B) == 6 && partialDispatcher.Dispatch(&d1A, &d3B) == 7);
+		partialDispatcher.Update();
+		assert(partialDispatcher.Dispatch(&d3A, &d3B) == 6 && partialDispatcher.Dispatch(&d1A, &d1C) == 0);
+
+		// Arguments through secondary bases
+		Dispatcher2<Base1, Base2, int> crossDispatcher;
+		crossDispatcher.Add<&HandlePair<1, Multi1A, Base2>>();
+		crossDispatcher.Add<&HandlePair<2, Base1, Multi1A>>();
+		Derived1D d1D;
+		assert(crossDispatcher.Dispatch(&m1A, &d1D) == 1 && theDispatchedFirst == &m1A && theDispatchedSecond == &d1D);
+		assert(crossDispatcher.Dispatch(&d1A, &m1A) == 2 && theDispatchedFirst == &d1A && theDispatchedSecond == &m1A);
+		assert(crossDispatcher.Dispatch(&m1A, &m1A) == 1 && theDispatchedSecond == static_cast<Base2*>(&m1A));
+	}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Wrong cast, 1 level deep. KCL i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
-		}
+	{
+		// The most specific arm is called whatever the order of the arms, with the object cast to its type
+		const void* matched = nullptr;
+		auto match = [&matched](Base1* anObject) {
+			return Match(
+				anObject, [&](Base1& anArm) { matched = &anArm; return 1; }, [&](Derived3A& anArm) { matched = &anArm; return 3; },
+				[&](Derived1A& anArm) { matched = &anArm; return 2; }, [&](Base2& anArm) { matched = &anArm; return 4; });
+		};
+
+		Base1 base1;
+		Derived1A d1A;
+		Derived7A d7A;
+		Derived1B d1B;
+		Multi1A m1A;
+		Multi3B m3B;
+		assert(match(&base1) == 1 && matched == &base1);
+		assert(match(&d1A) == 2 && matched == &d1A);
+		assert(match(&d7A) == 3 && matched == static_cast<Derived3A*>(&d7A));
+		assert(match(&d1B) == 1 && matched == &d1B);
+		// Base1 and Base2 cannot be ordered, nor Derived3A and Base2. Base1 is present several times in Multi3B.
+		assert(match(&m1A) == 1 && matched == &m1A);
+		assert(match(static_cast<Derived3B*>(&m3B)) == 3 && matched == static_cast<Derived3A*>(&m3B));
+		assert(match(nullptr) == 0);
+
+		// Cross cast to an arm that is not a base of the pointer
+		Base1* m1APtr = &m1A;
+		assert(Match(m1APtr, [](Derived1A&) { return 1; }, [&](Base2& anArm) { matched = &anArm; return 2; }) == 2);
+		assert(matched == static_cast<Base2*>(&m1A));
+
+		// Objects matching no arm, const objects and arms without a result
+		const Derived1B& constD1B = d1B;
+		assert(Match(&constD1B, [](const Derived1A&) { return 1.f; }) == 0.f);
+		int count = 0;
+		Match(&constD1B, [&count](const Derived1B&) { ++count; }, [](const Base1&) {});
+		assert(count == 1);
 	}
 
-	// Wrong cast, 3 level deep
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
+		// Events are received by the subscribers of their type and of all their bases, in subscription order
+		TypeEventBus bus;
+		std::vector<int> received;
+		const void* receivedBase2 = nullptr;
+		EventSubscription base1Subscription = bus.Subscribe<Base1>([&](const Base1&) { received.push_back(1); });
+		bus.Subscribe<Derived3A>([&](const Derived3A&) { received.push_back(3); });
+		bus.Subscribe<Derived1A>([&](const Derived1A&) { received.push_back(2); });
+		bus.Subscribe<Base2>([&](const Base2& anEvent) {
+			receivedBase2 = &anEvent;
+			received.push_back(4);
+		});
+
+		bus.Publish(Derived7A());
+		assert(received == std::vector<int>({1, 3, 2}));
+		received.clear();
+
+		// Published through any base, subscribers get the subobject of their type
+		Multi1A m1A;
+		bus.Publish(static_cast<const Base2&>(m1A));
+		assert(received == std::vector<int>({1, 4}) && receivedBase2 == static_cast<Base2*>(&m1A));
+		received.clear();
+		bus.Publish(Derived1B());
+		assert(received == std::vector<int>({1}));
+		received.clear();
+		assert(bus.GetHandlerCount(GetTypeInfo<Derived7A>()) == 3 && bus.GetHandlerCount(GetTypeInfo<Multi1A>()) == 2);
+
+		// Only the lists of the types deriving from the subscribed type are invalidated
+		EventSubscription derived2BSubscription = bus.Subscribe<Derived2B>([](const Derived2B&) {});
+		assert(bus.GetHandlerCount(GetTypeInfo<Derived7A>()) == 3 && bus.GetHandlerCount(GetTypeInfo<Derived1B>()) == 1);
+		assert(bus.Unsubscribe(base1Subscription) && !bus.Unsubscribe(base1Subscription));
+		assert(bus.GetHandlerCount(GetTypeInfo<Derived7A>()) == 0 && bus.GetHandlerCount(GetTypeInfo<Derived1B>()) == 0);
+		bus.Publish(Derived7A());
+		assert(received == std::vector<int>({3, 2}) && bus.GetHandlerCount(GetTypeInfo<Derived7A>()) == 2);
+		received.clear();
+
+		// Events published by a subscriber, of a type published for the first time
+		bus.Subscribe<Derived5A>([&](const Derived5A&) { bus.Publish(Derived1C()); });
+		bus.Subscribe<Derived1C>([&](const Derived1C&) { received.push_back(5); });
+		bus.Publish(Derived7A());
+		assert(received == std::vector<int>({3, 2, 5}));
+		assert(bus.Unsubscribe(derived2BSubscription));
+
+		// Published through a base present several times in the type, from a subobject other than the first one
+		const Multi7B* receivedMulti7B = nullptr;
+		const Derived7F* receivedDerived7F = nullptr;
+		bus.Subscribe<Multi7B>([&](const Multi7B& anEvent) { receivedMulti7B = &anEvent; });
+		bus.Subscribe<Derived7F>([&](const Derived7F& anEvent) { receivedDerived7F = &anEvent; });
+		Multi7B multi7B;
+		bus.Publish(static_cast<const Base2&>(static_cast<const Derived7F&>(multi7B)));
+		assert(receivedMulti7B == &multi7B && receivedDerived7F == static_cast<Derived7F*>(&multi7B));
+	}
 
-		for (int i = 0; i < iterations; i++)
+	{
+		// Every registered type in a map and a set, then every other type removed
+		TypeMap<size_t> typeMap;
+		TypeSet typeSet;
+		assert(typeMap.IsEmpty() && !typeMap.Find(GetTypeId<Base1>()) && !typeSet.Contains(GetTypeId<Base1>()));
+		std::vector<typeId_t> typeIds;
+		for (const TypeInfo* typeInfo : TypeRegistry::GetInstance())
 		{
-			testObjects.emplace_back(make_shared<Derived3A>());
-			testObjects.emplace_back(make_shared<Derived3B>());
-			testObjects.emplace_back(make_shared<Derived3C>());
+			typeIds.push_back(typeInfo->GetTypeId());
+			typeMap.Add(typeInfo->GetTypeId(), typeIds.size());
+			assert(typeSet.Add(typeInfo->GetTypeId()) && !typeSet.Add(typeInfo->GetTypeId()));
 		}
+		assert(typeMap.GetCount() == typeIds.size() && typeSet.GetCount() == typeIds.size());
 
-		// Upcast std
+		for (size_t i = 0; i < typeIds.size(); i += 2)
+			assert(typeMap.Remove(typeIds[i]) && !typeMap.Remove(typeIds[i]) && typeSet.Remove(typeIds[i]));
+		for (size_t i = 0; i < typeIds.size(); ++i)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Wrong cast, 3 level deep. STD i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
+			const size_t* value = typeMap.Find(typeIds[i]);
+			assert(i % 2 == 0 ? !value && !typeSet.Contains(typeIds[i]) : *value == i + 1 && typeSet.Contains(typeIds[i]));
 		}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Wrong cast, 3 level deep. KCL i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
-		}
+		// Iteration visits the remaining entries once
+		size_t sum = 0;
+		size_t count = 0;
+		typeMap.ForEach([&](typeId_t aTypeId, size_t aValue) {
+			assert(typeSet.Contains(aTypeId));
+			sum += aValue;
+		});
+		typeSet.ForEach([&](typeId_t) { ++count; });
+		assert(count == typeIds.size() / 2 && count == typeMap.GetCount() && sum == count * (count + 1));
+
+		// Values are default constructed when first accessed, removed values are released
+		TypeMap<std::unique_ptr<int>> pointers;
+		assert(!pointers.FindOrAdd(GetTypeId<Derived7A>()));
+		pointers.FindOrAdd(GetTypeId<Derived7A>()).reset(new int(7));
+		assert(**pointers.Find(GetTypeId<Derived7A>()) == 7 && pointers.Remove(GetTypeId<Derived7A>()));
+		assert(!pointers.FindOrAdd(GetTypeId<Derived7A>()));
+		typeMap.Clear();
+		typeSet.Clear();
+		assert(typeMap.IsEmpty() && !typeMap.Contains(typeIds[1]) && typeSet.IsEmpty() && !typeSet.Contains(typeIds[1]));
 	}
 
-	// Wrong cast, 7 level deep
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
+		// Registered types record how to create them, including types completed after their registration
+		const ObjectTraits& circleTraits = GetTypeInfo<Circle>()->GetObjectTraits();
+		assert(circleTraits.mySize == sizeof(Circle) && circleTraits.myAlignment == alignof(Circle));
+		assert(GetTypeInfo<Forward>()->GetObjectTraits().mySize == sizeof(Forward));
+		void* newCircle = circleTraits.myNew();
+		assert(static_cast<Circle*>(newCircle)->KCL_RTTI_GetTypeInfo() == GetTypeInfo<Circle>());
+		circleTraits.myDelete(newCircle);
+
+		// Objects are created by id or by name, and returned as any of their bases
+		ObjectFactory factory;
+		Shape* shapes[3];
+		for (Shape*& shape : shapes)
+			shape = factory.Create<Shape>(GetTypeId<Circle>());
+		assert(shapes[0]->KCL_RTTI_GetTypeInfo() == GetTypeInfo<Circle>() && static_cast<Circle*>(shapes[2])->myRadius == 0);
+		Base2* multiBase2 = factory.Create<Base2>("Multi1A");
+		assert(multiBase2 && kcl_dynamic_cast<Multi1A*>(multiBase2) == static_cast<Multi1A*>(multiBase2));
+		assert(factory.Create<Base3>(GetTypeId<Circle>()) == nullptr);
+		assert(factory.Create<Shape>("Unknown") == nullptr);
+
+		// Pools count their objects, freed slots are reused first
+		TypePool& circlePool = factory.GetPool(GetTypeInfo<Circle>());
+		assert(circlePool.GetLiveCount() == 3 && circlePool.GetHighWaterMark() == 3 && circlePool.GetCapacity() >= 3);
+		Shape* destroyedShape = shapes[1];
+		factory.Destroy(shapes[1]);
+		assert(circlePool.GetLiveCount() == 2 && circlePool.GetHighWaterMark() == 3);
+		shapes[1] = factory.Create<Shape>(GetTypeInfo<Circle>());
+		assert(shapes[1] == destroyedShape);
+		circlePool.ResetHighWaterMark();
+		assert(circlePool.GetHighWaterMark() == 3);
+
+		// Destroyed through a secondary base
+		factory.Destroy(multiBase2);
+		for (Shape* shape : shapes)
+			factory.Destroy(shape);
+		assert(circlePool.GetLiveCount() == 0 && circlePool.GetHighWaterMark() == 3);
+
+		// Destroyed through a base present several times in the type, from a subobject other than the first one
+		Multi7B* multi7B = factory.Create<Multi7B>(GetTypeId<Multi7B>());
+		Base1* secondBase1 = static_cast<Derived7B*>(multi7B);
+		Base2* thirdBase2 = static_cast<Derived7F*>(multi7B);
+		const TypeInfo* mostDerivedTypeInfo = nullptr;
+		assert(GetMostDerived(thirdBase2, mostDerivedTypeInfo) == (intptr_t)multi7B && mostDerivedTypeInfo == GetTypeInfo<Multi7B>());
+		assert(GetMostDerived(secondBase1, mostDerivedTypeInfo) == (intptr_t)multi7B);
+		factory.Destroy(secondBase1);
+		assert(factory.GetPool(GetTypeInfo<Multi7B>()).GetLiveCount() == 0);
+		assert(factory.Create<Multi7B>(GetTypeId<Multi7B>()) == multi7B);
+		factory.Destroy(thirdBase2);
+
+		size_t poolCount = 0;
+		factory.ForEachPool([&](const TypePool& aPool) {
+			assert(aPool.GetLiveCount() == 0);
+			poolCount++;
+		});
+		assert(poolCount == 3);
+
+		// Pools grow past their first chunk, slots are aligned for the type
+		TypePool pool(GetTypeInfo<Multi7B>(), 2);
+		std::vector<void*> objects;
+		for (int i = 0; i < 100; i++)
 		{
-			testObjects.emplace_back(make_shared<Derived7A>());
-			testObjects.emplace_back(make_shared<Derived7B>());
-			testObjects.emplace_back(make_shared<Derived7C>());
+			objects.push_back(pool.Create());
+			assert((uintptr_t)objects.back() % alignof(Multi7B) == 0);
 		}
+		pool.Reserve(1000);
+		assert(pool.GetCapacity() >= 1000 && pool.GetHighWaterMark() == 100);
+		for (void* object : objects)
+			pool.Destroy(object);
+	}
 
-		// Upcast std
+	{
+		// Archived objects get their vtable pointers back on load, including the ones of secondary bases
+		Circle circle;
+		circle.myLayer = 2;
+		circle.myRadius = 3;
+		Multi1A multi;
+		multi.myIntBase1 = 4;
+		multi.myIntBase2 = 5;
+		multi.myIntMulti1A = 6;
+
+		ArchiveWriter archiveWriter;
+		assert(archiveWriter.Add(&circle) == 0);
+		assert(archiveWriter.Add<Base2>(&multi) == 1);
+		assert(archiveWriter.Add<Shape>(&circle) == 2);
+		std::vector<uint8_t> archiveData;
+		archiveWriter.Write(archiveData);
+
+		// The type index is written in place of the vtable pointer, the last object is the first type
+		uintptr_t typeIndex = 1;
+		memcpy(&typeIndex, archiveData.data() + archiveData.size() - sizeof(Circle), sizeof(typeIndex));
+		assert(typeIndex == 0);
+
+		std::vector<uint8_t> loadedData = archiveData;
+		ObjectArchive archive;
+		assert(archive.LoadFromMemory(loadedData.data(), loadedData.size()) == ArchiveResult::Ok);
+		assert(archive.GetObjectCount() == 3);
+		assert(archive.GetTypeInfo(1) == GetTypeInfo<Multi1A>());
+		Circle* loadedCircle = archive.Get<Circle>(0);
+		assert(loadedCircle && loadedCircle->KCL_RTTI_GetTypeInfo() == GetTypeInfo<Circle>());
+		assert(loadedCircle->myLayer == 2 && loadedCircle->myRadius == 3);
+		Base2* loadedBase2 = archive.Get<Base2>(1);
+		assert(loadedBase2 && loadedBase2->KCL_RTTI_GetTypeInfo() == GetTypeInfo<Multi1A>());
+		assert(kcl_dynamic_cast<Multi1A*>(loadedBase2)->myIntBase1 == 4 && loadedBase2->myIntBase2 == 5);
+		assert(archive.Get<Base2>(0) == nullptr);
+		assert(archive.Get<Shape>(2)->KCL_RTTI_GetTypeInfo() == GetTypeInfo<Circle>());
+
+		// Added through a base present several times in the type, from a subobject other than the first one
+		Multi7B multi7B;
+		multi7B.myIntMulti7B = 7;
+		multi7B.myIntDerived7F = 8;
+		ArchiveWriter multiWriter;
+		multiWriter.Add<Base2>(static_cast<Derived7F*>(&multi7B));
+		multiWriter.Add<Base1>(static_cast<Derived7B*>(&multi7B));
+		std::vector<uint8_t> multiData;
+		multiWriter.Write(multiData);
+		ObjectArchive multiArchive;
+		assert(multiArchive.LoadFromMemory(multiData.data(), multiData.size()) == ArchiveResult::Ok);
+		for (size_t i = 0; i < 2; i++)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Wrong cast, 7 level deep. STD i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
+			Multi7B* loadedMulti7B = multiArchive.Get<Multi7B>(i);
+			assert(loadedMulti7B && loadedMulti7B->myIntMulti7B == 7 && loadedMulti7B->myIntDerived7F == 8);
+			assert(kcl_dynamic_cast<Multi7B*>(static_cast<Base2*>(static_cast<Derived7F*>(loadedMulti7B))) == loadedMulti7B);
 		}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Wrong cast, 7 level deep. KCL i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
-		}
+		// Changes of format, types or layouts are detected
+		auto loadModified = [&](auto aModify) {
+			loadedData = archiveData;
+			aModify(loadedData);
+			return archive.LoadFromMemory(loadedData.data(), loadedData.size());
+		};
+		assert(loadModified([](std::vector<uint8_t>& someData) { someData[0] ^= 1; }) == ArchiveResult::InvalidFormat);
+		assert(loadModified([](std::vector<uint8_t>& someData) { someData.pop_back(); }) == ArchiveResult::InvalidFormat);
+		assert(archive.GetObjectCount() == 0);
+		assert(loadModified([](std::vector<uint8_t>& someData) {
+				   someData[sizeof(KCL::RTTI_Private::ArchiveHeader)] ^= 1;
+			   }) == ArchiveResult::LayoutMismatch);
+		assert(strcmp(archive.GetErrorTypeName(), "Circle") == 0);
+		assert(loadModified([](std::vector<uint8_t>& someData) {
+				   auto name = std::search(someData.begin(), someData.end(), "Multi1A", "Multi1A" + 7);
+				   *name = 'X';
+			   }) == ArchiveResult::UnknownType);
+		assert(strcmp(archive.GetErrorTypeName(), "Xulti1A") == 0);
+		assert(loadModified([](std::vector<uint8_t>& someData) { someData[someData.size() - sizeof(Circle)] = 7; })
+			   == ArchiveResult::InvalidFormat);
+		assert(loadModified([](std::vector<uint8_t>& someData) {
+				   KCL::RTTI_Private::ArchiveHeader header;
+				   memcpy(&header, someData.data(), sizeof(header));
+				   const uint64_t offset = UINT64_MAX - 3;
+				   memcpy(someData.data() + sizeof(header) + header.myTypeCount * sizeof(KCL::RTTI_Private::ArchiveType), &offset,
+						  sizeof(offset));
+			   }) == ArchiveResult::InvalidFormat);
+
+		// Files are mapped
+		const char* path = "KCL_RTTI_Test.archive";
+		assert(archiveWriter.Save(path));
+		assert(archive.Load(path) == ArchiveResult::Ok);
+		assert(archive.Get<Multi1A>(1)->myIntMulti1A == 6 && archive.Get<Circle>(2)->myRadius == 3);
+		archive.Release();
+		remove(path);
+		assert(archive.Load(path) == ArchiveResult::CannotOpen);
 	}
 
-	// nullptr cast
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(nullptr);
-			testObjects.emplace_back(nullptr);
-			testObjects.emplace_back(nullptr);
-		}
+		// Every registered type is enumerated in id order and can be found back by id and by name
+		const TypeRegistry& registry = TypeRegistry::GetInstance();
+		assert(registry.GetTypeCount() > 0);
 
-		// Upcast std
+		typeId_t previousId = 0;
+		for (const TypeInfo* typeInfo : registry)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Nullptr cast STD i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
+			assert(typeInfo->GetTypeId() > previousId);
+			previousId = typeInfo->GetTypeId();
+			assert(registry.FindById(typeInfo->GetTypeId()) == typeInfo);
+			assert(registry.FindByName(typeInfo->GetName()) == typeInfo);
 		}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Multi1A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Nullptr cast KCL i: %zu, time (ms): %f\n", testObjects.size(), deltaTime.count() / (float)loopCount);
-		}
+		assert(registry.FindByName("Multi7B") == GetTypeInfo<Multi7B>());
+		assert(registry.FindByName("KCL_Test::Forward") == GetTypeInfo<Forward>());
+		assert(registry.FindByName("Multi7B", 5) == nullptr);
+		assert(registry.FindByName("Base1Suffix", 5) == GetTypeInfo<Base1>());
+		assert(registry.FindByName("Base") == nullptr);
+		assert(registry.FindByName("Base12") == nullptr);
+		assert(registry.FindByName("") == nullptr);
+		assert(registry.FindById(0) == nullptr);
+
+		// Byte sizes match the structures holding the type info and the offsets
+		using KCL::RTTI_Private::TypeInfoImpl;
+		using KCL::RTTI_Private::TypeOffsets;
+		assert(TypeRegistry::GetTypeDataByteSize(GetTypeInfo<Base1>()) == sizeof(TypeInfoImpl<Base1>) + sizeof(TypeOffsets<0>));
+		assert(TypeRegistry::GetTypeDataByteSize(GetTypeInfo<Multi1A>()) == sizeof(TypeInfoImpl<Multi1A>) + sizeof(TypeOffsets<1>));
+		assert(TypeRegistry::GetTypeDataByteSize(GetTypeInfo<Multi7B>()) == sizeof(TypeInfoImpl<Multi7B>) + sizeof(TypeOffsets<5>));
+		assert(registry.GetTotalTypeDataByteSize() >= registry.GetTypeCount() * sizeof(TypeInfoImpl<Base1>));
 	}
 
-	// Multiple inheritance, base1, 1 level deep
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
+		// Cached casts must agree with uncached ones, more dynamic types than cache entries go through the same call site
+		Multi7B m7B;
+		Multi1A m1A;
+		Derived7A d7A;
+		Derived1A d1A;
+		Base1 b1;
+		Base1* objects[] = {static_cast<Derived7A*>(&m7B), &m1A, &d7A, &d1A, &b1};
+
+		for (int loop = 0; loop < 3; loop++)
 		{
-			testObjects.emplace_back(make_shared<Multi1A>());
-			testObjects.emplace_back(make_shared<Multi1A>());
-			testObjects.emplace_back(make_shared<Multi1A>());
-		}
-
-		// Upcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base1, 1 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			for (Base1* object : objects)
+			{
+				assert((CachedCast<Derived7F, Base1>(object) == kcl_dynamic_cast<Derived7F*>(object)));
+				assert((CachedCast<Derived1A, Base1>(object) == kcl_dynamic_cast<Derived1A*>(object)));
+				assert((CachedCast<Multi1A, Base1>(object) == kcl_dynamic_cast<Multi1A*>(object)));
+				assert((CachedCast<Base2, Base1>(object) == kcl_dynamic_cast<Base2*>(object)));
+			}
 		}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+		// Same dynamic type repeatedly, hits after the first cast
+		for (int loop = 0; loop < 3; loop++)
+			assert((CachedCast<Derived7F, Base1>(objects[0]) == static_cast<Derived7F*>(&m7B)));
 
-			printf("Multiple inheritance, base1, 1 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Downcast std
+		// Another Base1 of the same dynamic type, the offset to the result is not the one of the first Base1
+		Base1* secondBase1 = static_cast<Derived7B*>(&m7B);
+		for (int loop = 0; loop < 3; loop++)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Derived7A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base1, 1 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			assert((CachedCast<Derived7F, Base1>(objects[0]) == static_cast<Derived7F*>(&m7B)));
+			assert((CachedCast<Derived7F, Base1>(secondBase1) == static_cast<Derived7F*>(&m7B)));
+			assert((CachedCast<Derived7B, Base1>(secondBase1) == static_cast<Derived7B*>(&m7B)));
+			assert((CachedCast<Derived7B, Base1>(objects[0]) == static_cast<Derived7B*>(&m7B)));
 		}
-
-		// Downcast kcl
+		Base2* thirdBase2 = static_cast<Derived7F*>(&m7B);
+		assert((CachedCast<Derived7A, Base2>(static_cast<Derived7D*>(&m7B)) == static_cast<Derived7A*>(&m7B)));
+		assert((CachedCast<Derived7A, Base2>(thirdBase2) == static_cast<Derived7A*>(&m7B)));
+
+		assert((CachedCast<Derived7F, Base1>(nullptr) == nullptr));
+		assert((CachedCast<Base1, Derived7A>(&m7B) == static_cast<Base1*>(static_cast<Derived7A*>(&m7B))));
+
+#if KCL_RTTI_CAST_CACHE_STATS
+		// Caches are listed once used, the casts above both hit and miss
+		uint64_t hitCount = 0;
+		uint64_t missCount = 0;
+		for (const CastCache* cache = CastCache::GetFirst(); cache != nullptr; cache = cache->GetNext())
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Derived7A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base1, 1 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			hitCount += cache->GetHitCount();
+			missCount += cache->GetMissCount();
 		}
+		assert(hitCount > 0 && missCount > 0);
+#endif
 	}
 
-	// Multiple inheritance, base2, 1 level deep
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base2>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Multi1A>());
-			testObjects.emplace_back(make_shared<Multi1A>());
-			testObjects.emplace_back(make_shared<Multi1A>());
-		}
+		// Batches agree with single casts, including repeated types and null pointers
+		Multi7B m7B;
+		Multi1A m1A;
+		Derived7A d7A;
+		Derived1A d1A;
+		Base1 b1;
+		// The second and third Base1 of a Multi7B are at other offsets from the result than the first one
+		Base1* objects[] = {static_cast<Derived7A*>(&m7B), &m1A, nullptr, &d7A, &d1A, &b1, static_cast<Derived7B*>(&m7B), &m1A,
+			static_cast<Derived7A*>(&m7B), &d7A, &d1A, static_cast<Derived7C*>(&m7B), &b1, nullptr};
+		const size_t count = sizeof(objects) / sizeof(objects[0]);
+
+		auto checkBatch = [&](auto* aTypedNull) {
+			typedef typename std::remove_pointer<decltype(aTypedNull)>::type Derived;
+			Derived* results[count];
+			DynamicCastBatch<Derived>(objects, count, results);
+			for (size_t i = 0; i < count; ++i)
+				assert(results[i] == kcl_dynamic_cast<Derived*>(objects[i]));
+
+			Derived* filtered[count];
+			const size_t filteredCount = DynamicCastFilter<Derived>(objects, count, filtered);
+			size_t expectedIndex = 0;
+			for (size_t i = 0; i < count; ++i)
+				if (Derived* expected = kcl_dynamic_cast<Derived*>(objects[i]))
+					assert(filtered[expectedIndex++] == expected);
+			assert(filteredCount == expectedIndex);
+		};
+
+		checkBatch((Base1*)nullptr);
+		checkBatch((Derived1A*)nullptr);
+		checkBatch((Derived7F*)nullptr);
+		checkBatch((Multi1A*)nullptr);
+		checkBatch((Base2*)nullptr);
+		checkBatch((Derived7B*)nullptr);
+		checkBatch((Forward*)nullptr);
+	}
 
-		// Upcast std
+	{
+		// Objects are visited segment by segment, by base or by derived type
+		KCL::PolyCollection<Base1> collection;
+		for (int i = 0; i < 3; i++)
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base2>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base2, 1 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			collection.Emplace<Derived1A>();
+			collection.Emplace<Derived3A>().myIntDerived3A = i;
+			collection.Insert(Multi1A());
 		}
+		collection.Emplace<Derived1B>();
+
+		assert(collection.GetSize() == 10);
+		assert(collection.GetSize<Derived3A>() == 3);
+		assert(collection.GetSize<Derived2A>() == 0);
+
+		int visitCount = 0;
+		collection.ForEach([&](Base1& anObject) {
+			assert(kcl_dynamic_cast<Base1*>(&anObject) == &anObject);
+			visitCount++;
+		});
+		assert(visitCount == 10);
+
+		visitCount = 0;
+		collection.ForEach<Derived1A>([&](Derived1A& anObject) {
+			assert(kcl_dynamic_cast<Derived1A*>(static_cast<Base1*>(&anObject)) == &anObject);
+			visitCount++;
+		});
+		assert(visitCount == 6);
+
+		int sum = 0;
+		collection.ForEach<Derived3A>([&](Derived3A& anObject) { sum += anObject.myIntDerived3A; });
+		assert(sum == 0 + 1 + 2);
+
+		// Base2 is a secondary base of Multi1A, the offset is applied to every object
+		collection.ForEach<Multi1A>([](Multi1A& anObject) { anObject.myIntBase2 = 42; });
+		visitCount = 0;
+		const KCL::PolyCollection<Base1>& constCollection = collection;
+		constCollection.ForEach<Base2>([&](const Base2& anObject) {
+			assert(anObject.myIntBase2 == 42);
+			visitCount++;
+		});
+		assert(visitCount == 3);
+
+		collection.Clear();
+		assert(collection.IsEmpty());
+	}
 
-		// Upcast kcl
+#if KCL_RTTI_PROFILE
+	{
+		// Casts of the same pair are merged, each one compares an id of the head and walks the Base2 block
+		auto findRecord = [](typeId_t aTypeId, typeId_t aTargetTypeId) {
+			for (const CastProfileRecord& record : GetCastProfile())
+				if (record.myTypeId == aTypeId && record.myTargetTypeId == aTargetTypeId)
+					return record;
+			return CastProfileRecord{aTypeId, aTargetTypeId, 0, 0, 0, 0};
+		};
+
+		Multi1A m1A;
+		Base1* object = &m1A;
+		const CastProfileRecord crosscastBefore = findRecord(GetTypeId<Multi1A>(), GetTypeId<Base2>());
+		const CastProfileRecord failedBefore = findRecord(GetTypeId<Multi1A>(), GetTypeId<Derived1D>());
+		for (int i = 0; i < 10; i++)
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base2>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base2, 1 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+			assert(kcl_dynamic_cast<Base2*>(object) == static_cast<Base2*>(&m1A));
+			assert(kcl_dynamic_cast<Derived1D*>(object) == nullptr);
 		}
 
-		// Downcast std
-		{
-			auto before = steady_clock::now();
+		const CastProfileRecord crosscast = findRecord(GetTypeId<Multi1A>(), GetTypeId<Base2>());
+		assert(crosscast.myCallCount - crosscastBefore.myCallCount == 10);
+		assert(crosscast.mySuccessCount - crosscastBefore.mySuccessCount == 10);
+		assert(crosscast.myTypeIdCount - crosscastBefore.myTypeIdCount == 20);
+		assert(crosscast.myBlockCount - crosscastBefore.myBlockCount == 10);
+
+		const CastProfileRecord failed = findRecord(GetTypeId<Multi1A>(), GetTypeId<Derived1D>());
+		assert(failed.myCallCount - failedBefore.myCallCount == 10);
+		assert(failed.mySuccessCount == failedBefore.mySuccessCount);
+		assert(failed.GetCost() - failedBefore.GetCost() == 30);
+
+		// Sorted by decreasing cost
+		const std::vector<CastProfileRecord> records = GetCastProfile();
+		for (size_t i = 1; i < records.size(); i++)
+			assert(records[i - 1].GetCost() >= records[i].GetCost());
+	}
+#endif
 
-			RunDynamicCastTest<Derived1D>(testObjects, loopCount);
+	// Note: this will result in ambiguous conversion which is expected
+	// Multi7B m;
+	// Base1* base1dyn = kcl_dynamic_cast<Base1*>(&m);
+}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+static int validCastCounter = 0;
+static size_t resultCounter = 0;
 
-			printf("Multiple inheritance, base2, 1 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+template<typename T>
+using TestObjects = std::vector<std::shared_ptr<T>>;
 
-		// Downcast kcl
-		{
-			auto before = steady_clock::now();
+template<typename Derived, typename T>
+KCL_NOINLINE size_t RunDynamicCastTest(const TestObjects<T>& testVector)
+{
+	for (const auto& it : testVector)
+	{
+		Derived* result = dynamic_cast<Derived*>(it.get());
+		if (result)
+			validCastCounter++;
+	}
+	return testVector.size();
+}
 
-			RunKCLCastTest<Derived1D>(testObjects, loopCount);
+// Casts objects whose primary base is T with an explicit scan strategy, T* must point to the complete object
+template<KCL::RTTI::TypeIdScan Scan, typename Derived, typename T>
+KCL_NOINLINE size_t RunKCLScanTest(const TestObjects<T>& testVector)
+{
+	using namespace KCL::RTTI;
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+	for (const auto& it : testVector)
+	{
+		intptr_t result =
+			it->KCL_RTTI_GetTypeInfo()->template CastTo<Scan>((intptr_t)it.get(), GetTypeId<Derived>(), GetTypeDepth<Derived>());
+		if (result)
+			validCastCounter++;
+	}
+	return testVector.size();
+}
 
-			printf("Multiple inheritance, base2, 1 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+template<typename Derived, typename T>
+KCL_NOINLINE size_t RunKCLCastTest(const TestObjects<T>& testVector)
+{
+	for (const auto& it : testVector)
+	{
+		Derived* result = kcl_dynamic_cast<Derived*>(it.get());
+		if (result)
+			validCastCounter++;
 	}
+	return testVector.size();
+}
 
-	// Multiple inheritance, base1, 3 level deep
+template<typename Derived, typename T>
+KCL_NOINLINE size_t RunKCLCachedCastTest(const TestObjects<T>& testVector)
+{
+	for (const auto& it : testVector)
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
+		Derived* result = KCL_CACHED_DYNAMIC_CAST(Derived*, it.get());
+		if (result)
+			validCastCounter++;
+	}
+	return testVector.size();
+}
 
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Multi3A>());
-			testObjects.emplace_back(make_shared<Multi3A>());
-			testObjects.emplace_back(make_shared<Multi3A>());
-		}
+template<typename Derived, typename T>
+KCL_NOINLINE size_t RunKCLMatrixCastTest(const KCL::RTTI::CastMatrix& aMatrix, const TestObjects<T>& testVector)
+{
+	for (const auto& it : testVector)
+	{
+		Derived* result = aMatrix.Cast<Derived*>(it.get());
+		if (result)
+			validCastCounter++;
+	}
+	return testVector.size();
+}
 
-		// Upcast std
-		{
-			auto before = steady_clock::now();
+static const int iterations = 1000000;
 
-			RunDynamicCastTest<Base1>(testObjects, loopCount);
+// Placement and order of the benchmark objects in memory
+enum class ObjectLayout
+{
+	Heap, // Separate allocations, types in turn
+	Arena, // Contiguous in a single buffer, types in turn
+	Scattered, // Each object in a random cache line of a buffer much larger than the caches
+	Shuffled, // Separate allocations, types in a random order
+	Skewed // Separate allocations, 90% of the first type and the others share the rest, in a random order
+};
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+static const std::vector<ObjectLayout> theObjectLayouts = {
+	ObjectLayout::Heap, ObjectLayout::Arena, ObjectLayout::Scattered, ObjectLayout::Shuffled, ObjectLayout::Skewed};
+// The order of the objects makes no difference when they all have the same type
+static const std::vector<ObjectLayout> theSingleTypeLayouts = {ObjectLayout::Heap, ObjectLayout::Arena, ObjectLayout::Scattered};
 
-			printf("Multiple inheritance, base1, 3 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+// Appended to the group name, the default layout keeps the plain name so that baselines still match
+static const char* GetLayoutSuffix(ObjectLayout aLayout)
+{
+	switch (aLayout)
+	{
+	case ObjectLayout::Arena:
+		return " [Arena]";
+	case ObjectLayout::Scattered:
+		return " [Scattered]";
+	case ObjectLayout::Shuffled:
+		return " [Shuffled]";
+	case ObjectLayout::Skewed:
+		return " [Skewed 90/5/5]";
+	default:
+		return "";
+	}
+}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
+// Objects constructed in place in a single buffer, the test objects share the ownership of the buffer
+template<typename T>
+struct ObjectBuffer
+{
+	explicit ObjectBuffer(size_t aSize)
+		: myMemory(new char[aSize])
+	{
+	}
 
-			RunKCLCastTest<Base1>(testObjects, loopCount);
+	~ObjectBuffer()
+	{
+		for (T* object : myObjects)
+			object->~T();
+	}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+	std::unique_ptr<char[]> myMemory;
+	std::vector<T*> myObjects;
+};
 
-			printf("Multiple inheritance, base1, 3 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
+// Objects of each of the types, aCountPerType times, in the given layout
+template<typename T, typename... Types>
+TestObjects<T> MakeTestObjects(ObjectLayout aLayout, size_t aCountPerType = iterations)
+{
+	static constexpr size_t theTypeCount = sizeof...(Types);
+	static constexpr size_t theSlotSize = ((std::max({sizeof(Types)...}) + 63) / 64) * 64;
+	const size_t objectCount = aCountPerType * theTypeCount;
+	std::mt19937 random(42);
+
+	// Type of each object, as an index in Types
+	std::vector<uint8_t> typeIndices(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		if (aLayout != ObjectLayout::Skewed || theTypeCount == 1)
+			typeIndices[i] = (uint8_t)(i % theTypeCount);
+		else
+		{
+			const size_t percent = random() % 100;
+			typeIndices[i] = percent < 90 ? 0 : (uint8_t)(1 + (percent - 90) * (theTypeCount - 1) / 10);
 		}
+	}
+	if (aLayout == ObjectLayout::Shuffled)
+		std::shuffle(typeIndices.begin(), typeIndices.end(), random);
 
-		// Downcast std
-		{
-			auto before = steady_clock::now();
+	TestObjects<T> testObjects;
+	testObjects.reserve(objectCount);
 
-			RunDynamicCastTest<Derived3A>(testObjects, loopCount);
+	if (aLayout != ObjectLayout::Arena && aLayout != ObjectLayout::Scattered)
+	{
+		static std::shared_ptr<T> (*const theAllocators[])() = {[]() -> std::shared_ptr<T> { return std::make_shared<Types>(); }...};
+		for (uint8_t typeIndex : typeIndices)
+			testObjects.push_back(theAllocators[typeIndex]());
+		return testObjects;
+	}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+	static T* (*const theConstructors[])(void*) = {[](void* aPlace) -> T* { return new (aPlace) Types(); }...};
+	static constexpr size_t theAlignment = alignof(std::max_align_t);
+	static const size_t theSizes[] = {((sizeof(Types) + theAlignment - 1) / theAlignment) * theAlignment...};
 
-			printf("Multiple inheritance, base1, 3 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+	// Scattered objects each get a cache line aligned slot, slots are used in a random order
+	std::vector<size_t> offsets(objectCount);
+	size_t bufferSize = 0;
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		offsets[i] = aLayout == ObjectLayout::Arena ? bufferSize : i * theSlotSize;
+		bufferSize += aLayout == ObjectLayout::Arena ? theSizes[typeIndices[i]] : theSlotSize;
+	}
+	if (aLayout == ObjectLayout::Scattered)
+		std::shuffle(offsets.begin(), offsets.end(), random);
 
-		// Downcast kcl
-		{
-			auto before = steady_clock::now();
+	// The buffer from new is aligned for any standard type, scattered slots are also aligned on cache lines
+	auto buffer = std::make_shared<ObjectBuffer<T>>(bufferSize + 64);
+	char* memory = buffer->myMemory.get();
+	if (aLayout == ObjectLayout::Scattered)
+		memory += (64 - (uintptr_t)memory % 64) % 64;
 
-			RunKCLCastTest<Derived3A>(testObjects, loopCount);
+	buffer->myObjects.reserve(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		T* object = theConstructors[typeIndices[i]](memory + offsets[i]);
+		buffer->myObjects.push_back(object);
+		testObjects.emplace_back(buffer, object);
+	}
+	return testObjects;
+}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+// Counter of a thread, alone on its cache line so that threads counting concurrently do not share the line
+struct alignas(64) ThreadCounter
+{
+	size_t myValue = 0;
+};
 
-			printf("Multiple inheritance, base1, 3 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+// Same loops as the single threaded cases, counting in the counter of the thread instead of validCastCounter
+template<typename Derived, typename T>
+KCL_NOINLINE void RunDynamicCastThreadTest(const TestObjects<T>& testVector, ThreadCounter& aCounter)
+{
+	for (const auto& it : testVector)
+	{
+		Derived* result = dynamic_cast<Derived*>(it.get());
+		if (result)
+			aCounter.myValue++;
 	}
+}
 
-	// Multiple inheritance, base2, 3 level deep
+template<typename Derived, typename T>
+KCL_NOINLINE void RunKCLCastThreadTest(const TestObjects<T>& testVector, ThreadCounter& aCounter)
+{
+	for (const auto& it : testVector)
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base2>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Multi3A>());
-			testObjects.emplace_back(make_shared<Multi3A>());
-			testObjects.emplace_back(make_shared<Multi3A>());
-		}
-
-		// Upcast std
-		{
-			auto before = steady_clock::now();
+		Derived* result = kcl_dynamic_cast<Derived*>(it.get());
+		if (result)
+			aCounter.myValue++;
+	}
+}
 
-			RunDynamicCastTest<Base2>(testObjects, loopCount);
+template<typename Derived, typename T>
+KCL_NOINLINE void RunKCLCachedCastThreadTest(const TestObjects<T>& testVector, ThreadCounter& aCounter)
+{
+	for (const auto& it : testVector)
+	{
+		Derived* result = KCL_CACHED_DYNAMIC_CAST(Derived*, it.get());
+		if (result)
+			aCounter.myValue++;
+	}
+}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+// Declares the cases of a hierarchy for each of the given layouts of its objects, each layout has its own fixture.
+// anAddCases(aGroup, aFixture) declares the cases.
+template<typename T, typename... Types, typename AddCases>
+void AddLayoutVariants(BenchmarkRunner& aRunner, const std::string& aGroup, const std::vector<ObjectLayout>& someLayouts,
+					   AddCases anAddCases)
+{
+	for (ObjectLayout layout : someLayouts)
+	{
+		auto objects = aRunner.AddFixture([layout]() { return MakeTestObjects<T, Types...>(layout); });
+		anAddCases(aGroup + GetLayoutSuffix(layout), objects);
+	}
+}
 
-			printf("Multiple inheritance, base2, 3 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+// std::dynamic_cast and KCL casts of the same objects
+template<typename Derived, typename T>
+void AddCastCases(BenchmarkRunner& aRunner, const std::string& aName, BenchmarkFixture<TestObjects<T>>* aFixture, bool anIsCached = true)
+{
+	aRunner.AddCase(aName + " STD", aFixture, RunDynamicCastTest<Derived, T>);
+	aRunner.AddCase(aName + " KCL", aFixture, RunKCLCastTest<Derived, T>);
+	if (anIsCached)
+		aRunner.AddCase(aName + " KCL Cached", aFixture, RunKCLCachedCastTest<Derived, T>);
+}
 
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
+// Upcast to the root of the objects, downcast and failed cast to types of other hierarchies
+template<typename Upcast, typename Downcast, typename T>
+void AddHierarchyCases(BenchmarkRunner& aRunner, const std::string& aGroup, BenchmarkFixture<TestObjects<T>>* aFixture)
+{
+	AddCastCases<Upcast>(aRunner, aGroup + "/Upcast", aFixture, false);
+	AddCastCases<Downcast>(aRunner, aGroup + "/Downcast", aFixture);
+}
 
-			RunKCLCastTest<Base2>(testObjects, loopCount);
+struct Particle
+{
+	Vector3 myPosition;
+	Vector3 myVelocity;
+	uint32_t myId;
+};
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+// Serialization of a field through a virtual call, as done without reflection
+struct VirtualFieldWriter
+{
+	virtual ~VirtualFieldWriter() {}
+	virtual void Write(KCL::RTTI::BinaryWriter& aWriter, const void* anObject) const = 0;
+};
 
-			printf("Multiple inheritance, base2, 3 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+template<typename Owner, typename Class, typename T, T Class::*Member>
+struct MemberWriter final : public VirtualFieldWriter
+{
+	void Write(KCL::RTTI::BinaryWriter& aWriter, const void* anObject) const override
+	{
+		aWriter.Write(static_cast<const Owner*>(anObject)->*Member);
+	}
+};
 
-		// Downcast std
-		{
-			auto before = steady_clock::now();
+typedef std::vector<std::unique_ptr<VirtualFieldWriter>> VirtualFieldWriters;
 
-			RunDynamicCastTest<Derived3D>(testObjects, loopCount);
+// Writes each field of each object with a virtual call
+template<typename T>
+KCL_NOINLINE size_t RunVirtualFieldWriterTest(const std::vector<T>& someObjects, const VirtualFieldWriters& someWriters,
+											  KCL::RTTI::BinaryWriter& aWriter)
+{
+	aWriter.Clear();
+	for (const T& object : someObjects)
+		for (const auto& writer : someWriters)
+			writer->Write(aWriter, &object);
+	return someObjects.size();
+}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+// Subscriber of an event bus finding its events with a cast, as done without flattened lists
+struct CastSubscriber
+{
+	KCL::RTTI::typeId_t myTypeId;
+	KCL::RTTI::typeId_t myDepth;
+	std::function<void(intptr_t)> myFunction;
+};
 
-			printf("Multiple inheritance, base2, 3 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+// The same subscribers in both buses, counting the events of each type
+template<typename... Types>
+void SubscribeEventCounters(KCL::RTTI::TypeEventBus& aBus, std::vector<CastSubscriber>& someSubscribers)
+{
+	using namespace KCL::RTTI;
 
-		// Downcast kcl
-		{
-			auto before = steady_clock::now();
+	auto subscribe = [&](auto aFunction, auto* aTypeTag) {
+		typedef typename std::remove_pointer<decltype(aTypeTag)>::type T;
+		someSubscribers.push_back(CastSubscriber{GetTypeId<T>(), GetTypeDepth<T>(),
+												 [aFunction](intptr_t anEvent) { aFunction(*reinterpret_cast<const T*>(anEvent)); }});
+		aBus.Subscribe<T>(aFunction);
+	};
+	(subscribe([](const Types& anEvent) { resultCounter += anEvent.myIntBase1; }, (Types*)nullptr), ...);
+}
 
-			RunKCLCastTest<Derived3D>(testObjects, loopCount);
+int RTTI_Benchmark(const BenchmarkOptions& someOptions)
+{
+	using namespace std;
+	using namespace KCL::RTTI;
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+	validCastCounter = 0;
+	resultCounter = 0;
+
+	BenchmarkRunner runner;
+
+	// Single inheritance hierarchies, 1, 3 and 7 levels deep
+	AddLayoutVariants<Base1, Derived1A, Derived1B, Derived1C>(
+		runner, "Single inheritance 1 level deep", theObjectLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base1, Derived1A>(runner, aGroup, anObjects);
+			AddCastCases<Multi1A>(runner, aGroup + "/Wrong cast", anObjects);
+		});
+	AddLayoutVariants<Base1, Derived3A, Derived3B, Derived3C>(
+		runner, "Single inheritance 3 levels deep", theObjectLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base1, Derived3A>(runner, aGroup, anObjects);
+			AddCastCases<Multi1A>(runner, aGroup + "/Wrong cast", anObjects);
+		});
+	AddLayoutVariants<Base1, Derived7A, Derived7B, Derived7C>(
+		runner, "Single inheritance 7 levels deep", theObjectLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base1, Derived7A>(runner, aGroup, anObjects);
+			AddCastCases<Multi1A>(runner, aGroup + "/Wrong cast", anObjects);
+		});
 
-			printf("Multiple inheritance, base2, 3 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+	// nullptr cast
+	{
+		auto objects = runner.AddFixture([]() { return TestObjects<Base1>(iterations * 3); });
+		AddCastCases<Multi1A>(runner, "Nullptr/Cast", objects);
 	}
 
-	// Multiple inheritance, base1, 7 levels deep for greater effect
+	// Multiple inheritance, from the first and the second base, 1, 3 and 7 levels deep
+	AddLayoutVariants<Base1, Multi1A, Multi1A, Multi1A>(
+		runner, "Multiple inheritance base1 1 level deep", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base1, Derived7A>(runner, aGroup, anObjects);
+		});
+	AddLayoutVariants<Base2, Multi1A, Multi1A, Multi1A>(
+		runner, "Multiple inheritance base2 1 level deep", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base2, Derived1D>(runner, aGroup, anObjects);
+		});
+	AddLayoutVariants<Base1, Multi3A, Multi3A, Multi3A>(
+		runner, "Multiple inheritance base1 3 levels deep", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base1, Derived3A>(runner, aGroup, anObjects);
+		});
+	AddLayoutVariants<Base2, Multi3A, Multi3A, Multi3A>(
+		runner, "Multiple inheritance base2 3 levels deep", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base2, Derived3D>(runner, aGroup, anObjects);
+		});
+	AddLayoutVariants<Base1, Multi7A, Multi7A, Multi7A>(
+		runner, "Multiple inheritance base1 7 levels deep", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base1, Derived7A>(runner, aGroup, anObjects);
+		});
+	AddLayoutVariants<Base2, Multi7A, Multi7A, Multi7A>(
+		runner, "Multiple inheritance base2 7 levels deep", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddHierarchyCases<Base2, Derived7D>(runner, aGroup, anObjects);
+		});
+
+	// Nested multiple inheritance 3*2, with a cast matrix over the Base1 to Base6 hierarchies
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base1>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Multi7A>());
-			testObjects.emplace_back(make_shared<Multi7A>());
-			testObjects.emplace_back(make_shared<Multi7A>());
-		}
-
-		// Upcast std
-		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base1, 7 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
-
-		// Upcast kcl
-		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base1>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base1, 7 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+		static auto getMatrix = []() -> const CastMatrix& {
+			static const CastMatrix theMatrix({GetTypeInfo<Base1>(), GetTypeInfo<Base2>(), GetTypeInfo<Base3>(), GetTypeInfo<Base4>(),
+												  GetTypeInfo<Base5>(), GetTypeInfo<Base6>()},
+				64 * 1024);
+			return theMatrix;
+		};
+		auto describeMatrix = [](const TestObjects<Base1>&, double) {
+			return "types: " + to_string(getMatrix().GetTypeCount()) + ", table (bytes): " + to_string(getMatrix().GetByteSize());
+		};
+
+		AddLayoutVariants<Base1, Multi4C, Multi5C, Multi6C>(
+			runner, "Nested multiple inheritance 3*2", theObjectLayouts, [&](const string& aGroup, auto anObjects) {
+				AddCastCases<Base4>(runner, aGroup + "/Crosscast", anObjects);
+				runner.AddCase(aGroup + "/Crosscast KCL Matrix", anObjects,
+					[](const TestObjects<Base1>& someObjects) { return RunKCLMatrixCastTest<Base4>(getMatrix(), someObjects); },
+					describeMatrix);
+				AddCastCases<Multi4C>(runner, aGroup + "/Downcast", anObjects);
+				runner.AddCase(aGroup + "/Downcast KCL Matrix", anObjects,
+					[](const TestObjects<Base1>& someObjects) { return RunKCLMatrixCastTest<Multi4C>(getMatrix(), someObjects); },
+					describeMatrix);
+			});
+	}
 
-		// Downcast std
+	// Downcast to a final type, 8 levels deep
+	AddLayoutVariants<Base1, Final7A, Derived7A, Derived1C>(
+		runner, "Final type 8 levels deep", theObjectLayouts, [&](const string& aGroup, auto anObjects) {
+			AddCastCases<Final7A>(runner, aGroup + "/Downcast", anObjects, false);
+			runner.AddCase(aGroup + "/Downcast KCL Walk", anObjects, [](const TestObjects<Base1>& someObjects) {
+				for (const auto& it : someObjects)
+					if (it->KCL_RTTI_DynamicCast(GetTypeId<Final7A>(), GetTypeDepth<Final7A>()))
+						validCastCounter++;
+				return someObjects.size();
+			});
+		});
+
+	// Wide multiple inheritance, scalar and SIMD scans of the secondary bases
+	// Derived7A is the primary base so pointers are to the complete object
+	AddLayoutVariants<Derived7A, Multi7B, Multi7B, Multi7B>(
+		runner, "Wide multiple inheritance 6*7", theSingleTypeLayouts, [&](const string& aGroup, auto anObjects) {
+			AddCastCases<Derived7F>(runner, aGroup + "/Crosscast", anObjects);
+			runner.AddCase(aGroup + "/Crosscast KCL Scalar", anObjects, RunKCLScanTest<TypeIdScan::Scalar, Derived7F, Derived7A>);
+			runner.AddCase(aGroup + "/Crosscast KCL SIMD", anObjects, RunKCLScanTest<TypeIdScan::SIMD, Derived7F, Derived7A>);
+			AddCastCases<Multi7A>(runner, aGroup + "/Wrong cast", anObjects);
+			runner.AddCase(aGroup + "/Wrong cast KCL Scalar", anObjects, RunKCLScanTest<TypeIdScan::Scalar, Multi7A, Derived7A>);
+			runner.AddCase(aGroup + "/Wrong cast KCL SIMD", anObjects, RunKCLScanTest<TypeIdScan::SIMD, Multi7A, Derived7A>);
+		});
+
+	// Batch casts of scattered objects, as done when filtering entities by type
+	{
+		struct BatchInput
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Derived7A>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+			TestObjects<Base1> myObjects;
+			vector<Base1*> myPointers;
+			vector<Base2*> myResults;
+		};
+
+		auto input = runner.AddFixture([]() {
+			BatchInput batchInput;
+			batchInput.myObjects.reserve(iterations * 3);
+			for (int i = 0; i < iterations; i++)
+			{
+				batchInput.myObjects.emplace_back(make_shared<Multi1A>());
+				batchInput.myObjects.emplace_back(make_shared<Derived3A>());
+				batchInput.myObjects.emplace_back(make_shared<Derived7A>());
+			}
 
-			printf("Multiple inheritance, base1, 7 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+			// Objects are shuffled so that consecutive pointers are not in the same cache lines
+			for (const auto& it : batchInput.myObjects)
+				batchInput.myPointers.push_back(it.get());
+			shuffle(batchInput.myPointers.begin(), batchInput.myPointers.end(), mt19937(42));
+			batchInput.myResults.resize(batchInput.myPointers.size());
+			return batchInput;
+		});
+
+		runner.AddCase("Batch crosscast of shuffled objects/STD", input, [](BatchInput& anInput) {
+			size_t count = 0;
+			for (Base1* it : anInput.myPointers)
+				if (Base2* result = dynamic_cast<Base2*>(it))
+					anInput.myResults[count++] = result;
+			resultCounter += count;
+			return anInput.myPointers.size();
+		});
+		runner.AddCase("Batch crosscast of shuffled objects/KCL", input, [](BatchInput& anInput) {
+			size_t count = 0;
+			for (Base1* it : anInput.myPointers)
+				if (Base2* result = kcl_dynamic_cast<Base2*>(it))
+					anInput.myResults[count++] = result;
+			resultCounter += count;
+			return anInput.myPointers.size();
+		});
+		runner.AddCase("Batch crosscast of shuffled objects/KCL Filter", input, [](BatchInput& anInput) {
+			resultCounter += DynamicCastFilter<Base2>(anInput.myPointers.data(), anInput.myPointers.size(), anInput.myResults.data());
+			return anInput.myPointers.size();
+		});
+	}
 
-		// Downcast kcl
+	// Iteration over a mixed set of objects, pointers to separate allocations against a collection segmented by type
+	{
+		struct MixedInput
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Derived7A>(testObjects, loopCount);
+			TestObjects<Base1> myObjects;
+			KCL::PolyCollection<Base1> myCollection;
+		};
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+		auto input = runner.AddFixture([]() {
+			MixedInput mixedInput;
+			mixedInput.myObjects.reserve(iterations * 3);
+			for (int i = 0; i < iterations; i++)
+			{
+				mixedInput.myObjects.emplace_back(make_shared<Derived1A>());
+				mixedInput.myObjects.emplace_back(make_shared<Derived3B>());
+				mixedInput.myObjects.emplace_back(make_shared<Multi1A>());
+				mixedInput.myCollection.Emplace<Derived1A>();
+				mixedInput.myCollection.Emplace<Derived3B>();
+				mixedInput.myCollection.Emplace<Multi1A>();
+			}
 
-			printf("Multiple inheritance, base1, 7 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+			// The order of types is random as in a set of entities
+			shuffle(mixedInput.myObjects.begin(), mixedInput.myObjects.end(), mt19937(42));
+			return mixedInput;
+		});
+
+		// The virtual call stands for the work done on each object
+		runner.AddCase("Mixed objects iteration/vector Virtual call", input, [](MixedInput& anInput) {
+			for (const auto& it : anInput.myObjects)
+				resultCounter += it->KCL_RTTI_GetTypeId();
+			return anInput.myObjects.size();
+		});
+		runner.AddCase("Mixed objects iteration/PolyCollection Virtual call", input, [](MixedInput& anInput) {
+			anInput.myCollection.ForEach([](Base1& anObject) { resultCounter += anObject.KCL_RTTI_GetTypeId(); });
+			return anInput.myObjects.size();
+		});
+		runner.AddCase("Mixed objects iteration/vector KCL Downcast", input, [](MixedInput& anInput) {
+			for (const auto& it : anInput.myObjects)
+				if (Derived1A* derived = kcl_dynamic_cast<Derived1A*>(it.get()))
+					resultCounter += derived->myIntBase1;
+			return anInput.myObjects.size();
+		});
+		runner.AddCase("Mixed objects iteration/PolyCollection Downcast", input, [](MixedInput& anInput) {
+			anInput.myCollection.ForEach<Derived1A>([](Derived1A& anObject) { resultCounter += anObject.myIntBase1; });
+			return anInput.myObjects.size();
+		});
 	}
 
-	// Multiple inheritance, base2, 7 levels deep for greater effect
+	// Type lookup by name, as done when loading data
 	{
-		// Prepare test vector
-		vector<shared_ptr<Base2>> testObjects;
-		testObjects.reserve(iterations * 3);
-
-		for (int i = 0; i < iterations; i++)
-		{
-			testObjects.emplace_back(make_shared<Multi7A>());
-			testObjects.emplace_back(make_shared<Multi7A>());
-			testObjects.emplace_back(make_shared<Multi7A>());
-		}
-
-		// Upcast std
+		struct LookupInput
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Base2>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
-
-			printf("Multiple inheritance, base2, 7 level deep. STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+			vector<string> myNames;
+			unordered_map<string, const TypeInfo*> myNameMap;
+		};
+
+		auto input = runner.AddFixture([]() {
+			const TypeRegistry& registry = TypeRegistry::GetInstance();
+			LookupInput lookupInput;
+			lookupInput.myNames.reserve(iterations);
+			for (int i = 0; i < iterations; i++)
+				lookupInput.myNames.emplace_back(registry[i % registry.GetTypeCount()]->GetName());
+			for (const TypeInfo* typeInfo : registry)
+				lookupInput.myNameMap.emplace(typeInfo->GetName(), typeInfo);
+			return lookupInput;
+		});
+
+		auto addLookupCase = [&](const char* aName, auto aLookup) {
+			runner.AddCase(
+				string("Type lookup by name/") + aName, input,
+				[aLookup](LookupInput& anInput) {
+					for (const string& name : anInput.myNames)
+						resultCounter += aLookup(anInput, name) != nullptr;
+					return anInput.myNames.size();
+				},
+				[](LookupInput&, double) { return "types: " + to_string(TypeRegistry::GetInstance().GetTypeCount()); });
+		};
+
+		addLookupCase("Linear", [](LookupInput&, const string& aName) -> const TypeInfo* {
+			for (const TypeInfo* typeInfo : TypeRegistry::GetInstance())
+				if (aName == typeInfo->GetName())
+					return typeInfo;
+			return nullptr;
+		});
+		addLookupCase("std::unordered_map", [](LookupInput& anInput, const string& aName) -> const TypeInfo* {
+			auto it = anInput.myNameMap.find(aName);
+			return it != anInput.myNameMap.end() ? it->second : nullptr;
+		});
+		addLookupCase("KCL", [](LookupInput&, const string& aName) {
+			return TypeRegistry::GetInstance().FindByName(aName.data(), aName.size());
+		});
+	}
 
-		// Upcast kcl
+	// Double dispatch of pairs of objects, as done to handle collisions, nested casts against a table of handlers
+	{
+		struct DispatchInput
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Base2>(testObjects, loopCount);
+			TestObjects<Base1> myObjects;
+			vector<pair<Base1*, Base1*>> myPairs;
+			Dispatcher2<Base1, Base1, int> myDispatcher;
+		};
+
+		auto input = runner.AddFixture([]() {
+			DispatchInput dispatchInput;
+			dispatchInput.myObjects = {make_shared<Derived1A>(), make_shared<Derived3A>(), make_shared<Derived3B>(), make_shared<Multi1A>(),
+				make_shared<Derived1C>()};
+			mt19937 random(42);
+			for (int i = 0; i < iterations; i++)
+			{
+				Base1* first = dispatchInput.myObjects[random() % dispatchInput.myObjects.size()].get();
+				Base1* second = dispatchInput.myObjects[random() % dispatchInput.myObjects.size()].get();
+				dispatchInput.myPairs.emplace_back(first, second);
+			}
+			AddPairHandlers(dispatchInput.myDispatcher);
+			return dispatchInput;
+		});
+
+		runner.AddCase("Double dispatch/KCL Nested casts", input, [](DispatchInput& anInput) {
+			for (const auto& it : anInput.myPairs)
+				resultCounter += DispatchPairByCasts(it.first, it.second);
+			return anInput.myPairs.size();
+		});
+		runner.AddCase(
+			"Double dispatch/KCL Dispatcher2", input,
+			[](DispatchInput& anInput) {
+				for (const auto& it : anInput.myPairs)
+					resultCounter += anInput.myDispatcher.Dispatch(it.first, it.second);
+				return anInput.myPairs.size();
+			},
+			[](DispatchInput& anInput, double) { return "table (bytes): " + to_string(anInput.myDispatcher.GetByteSize()); });
+	}
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+	// Switch on the type of shuffled objects, a ladder of casts against a match whose cost does not depend on the arm
+	{
+		auto objects = runner.AddFixture([]() {
+			TestObjects<Base1> testObjects;
+			testObjects.reserve(iterations);
+			for (int i = 0; i < iterations / 6; i++)
+			{
+				testObjects.emplace_back(make_shared<Derived7A>());
+				testObjects.emplace_back(make_shared<Derived5B>());
+				testObjects.emplace_back(make_shared<Derived3C>());
+				testObjects.emplace_back(make_shared<Derived1C>());
+				testObjects.emplace_back(make_shared<Derived2B>());
+				testObjects.emplace_back(make_shared<Final7A>());
+			}
+			shuffle(testObjects.begin(), testObjects.end(), mt19937(42));
+			return testObjects;
+		});
 
-			printf("Multiple inheritance, base2, 7 level deep. KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+		runner.AddCase("Type switch/KCL Cast ladder", objects, [](const TestObjects<Base1>& someObjects) {
+			for (const auto& it : someObjects)
+			{
+				if (Derived7A* derived7A = kcl_dynamic_cast<Derived7A*>(it.get()))
+					resultCounter += derived7A->myIntDerived7A;
+				else if (Derived5B* derived5B = kcl_dynamic_cast<Derived5B*>(it.get()))
+					resultCounter += derived5B->myIntDerived5B;
+				else if (Derived3C* derived3C = kcl_dynamic_cast<Derived3C*>(it.get()))
+					resultCounter += derived3C->myIntDerived3C;
+				else if (Derived1A* derived1A = kcl_dynamic_cast<Derived1A*>(it.get()))
+					resultCounter += derived1A->myIntDerived1A;
+				else if (Derived1B* derived1B = kcl_dynamic_cast<Derived1B*>(it.get()))
+					resultCounter += derived1B->myIntDerived1B;
+				else
+					resultCounter += it->myIntBase1;
+			}
+			return someObjects.size();
+		});
+		runner.AddCase("Type switch/KCL Match", objects, [](const TestObjects<Base1>& someObjects) {
+			for (const auto& it : someObjects)
+			{
+				resultCounter += Match(
+					it.get(), [](Derived7A& anObject) { return anObject.myIntDerived7A; },
+					[](Derived5B& anObject) { return anObject.myIntDerived5B; },
+					[](Derived3C& anObject) { return anObject.myIntDerived3C; },
+					[](Derived1A& anObject) { return anObject.myIntDerived1A; },
+					[](Derived1B& anObject) { return anObject.myIntDerived1B; }, [](Base1& anObject) { return anObject.myIntBase1; });
+			}
+			return someObjects.size();
+		});
+	}
 
-		// Downcast std
+	// Events received by the subscribers of their type and of its bases, casts per subscriber against flattened lists
+	{
+		struct EventInput
 		{
-			auto before = steady_clock::now();
-
-			RunDynamicCastTest<Derived7D>(testObjects, loopCount);
+			TestObjects<Base1> myEventObjects;
+			// Events are usually created just before they are published, they are in cache
+			vector<Base1*> myEvents;
+			vector<CastSubscriber> mySubscribers;
+			unique_ptr<TypeEventBus> myBus;
+		};
+
+		auto input = runner.AddFixture([]() {
+			EventInput eventInput;
+			eventInput.myEventObjects = {make_shared<Derived1A>(), make_shared<Derived3A>(), make_shared<Derived7A>(),
+										 make_shared<Derived2B>(), make_shared<Derived1C>()};
+			mt19937 random(42);
+			for (int i = 0; i < iterations; i++)
+				eventInput.myEvents.push_back(eventInput.myEventObjects[random() % eventInput.myEventObjects.size()].get());
 
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+			eventInput.myBus.reset(new TypeEventBus());
+			SubscribeEventCounters<Base1, Derived1A, Derived3A, Derived5A, Derived1B, Derived2B, Derived1C, Derived3C>(
+				*eventInput.myBus, eventInput.mySubscribers);
+			return eventInput;
+		});
 
-			printf("Multiple inheritance, base2, 7 level deep. STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+		runner.AddCase("Event bus/KCL Cast per subscriber", input, [](EventInput& anInput) {
+			for (Base1* event : anInput.myEvents)
+			{
+				const TypeInfo* typeInfo = event->KCL_RTTI_GetTypeInfo();
+				for (const CastSubscriber& subscriber : anInput.mySubscribers)
+					if (const intptr_t result = typeInfo->CastTo((intptr_t)event, subscriber.myTypeId, subscriber.myDepth))
+						subscriber.myFunction(result);
+			}
+			return anInput.myEvents.size();
+		});
+		runner.AddCase("Event bus/KCL TypeEventBus", input, [](EventInput& anInput) {
+			for (Base1* event : anInput.myEvents)
+				anInput.myBus->Publish(*event);
+			return anInput.myEvents.size();
+		});
+	}
 
-		// Downcast kcl
+	// Per-type statistics updated for each object, a hash map against a map indexed by type id
+	{
+		struct TypeMapInput
 		{
-			auto before = steady_clock::now();
-
-			RunKCLCastTest<Derived7D>(testObjects, loopCount);
-
-			auto after = steady_clock::now();
-			duration<double, std::milli> deltaTime = after - before;
+			vector<typeId_t> myTypeIds;
+			unordered_map<typeId_t, size_t> myHashMap;
+			TypeMap<size_t> myTypeMap;
+		};
+
+		auto input = runner.AddFixture([]() {
+			TypeMapInput typeMapInput;
+			vector<typeId_t> registeredIds;
+			for (const TypeInfo* typeInfo : TypeRegistry::GetInstance())
+			{
+				registeredIds.push_back(typeInfo->GetTypeId());
+				typeMapInput.myHashMap[typeInfo->GetTypeId()] = 0;
+				typeMapInput.myTypeMap.Add(typeInfo->GetTypeId(), 0);
+			}
 
-			printf("Multiple inheritance, base2, 7 level deep. KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-				deltaTime.count() / (float)loopCount);
-		}
+			mt19937 random(42);
+			for (int i = 0; i < iterations; i++)
+				typeMapInput.myTypeIds.push_back(registeredIds[random() % registeredIds.size()]);
+			return typeMapInput;
+		});
+
+		runner.AddCase("Type map/std::unordered_map", input, [](TypeMapInput& anInput) {
+			for (typeId_t typeId : anInput.myTypeIds)
+				++anInput.myHashMap.find(typeId)->second;
+			return anInput.myTypeIds.size();
+		});
+		runner.AddCase(
+			"Type map/KCL TypeMap", input,
+			[](TypeMapInput& anInput) {
+				for (typeId_t typeId : anInput.myTypeIds)
+					++*anInput.myTypeMap.Find(typeId);
+				return anInput.myTypeIds.size();
+			},
+			[](TypeMapInput& anInput, double) { return "map (bytes): " + to_string(anInput.myTypeMap.GetByteSize()); });
+	}
 
-		// Multiple inheritance 3*2
+	// Serialization of a snapshot, bulk copies of the type layout against a virtual call per field
+	{
+		struct SerializationInput
 		{
-			// Prepare test vector
-			vector<shared_ptr<Base1>> testObjects;
-			testObjects.reserve(iterations * 3);
-
+			vector<Particle> myParticles;
+			vector<Circle> myCircles;
+			vector<unique_ptr<Shape>> myShapes;
+			VirtualFieldWriters myParticleWriters;
+			VirtualFieldWriters myCircleWriters;
+			BinaryWriter myWriter;
+			// Circles written by the setup, for the read case
+			BinaryWriter myCircleData;
+		};
+
+		auto input = runner.AddFixture([]() {
+			SerializationInput serializationInput;
 			for (int i = 0; i < iterations; i++)
 			{
-				testObjects.emplace_back(make_shared<Multi4C>());
-				testObjects.emplace_back(make_shared<Multi5C>());
-				testObjects.emplace_back(make_shared<Multi6C>());
+				const float value = (float)i;
+				serializationInput.myParticles.push_back(Particle{{value, value, value}, {1, 0, 0}, (uint32_t)i});
+
+				Circle circle;
+				circle.myPosition = {value, value, 0};
+				circle.myLayer = i % 8;
+				circle.myRadius = value;
+				serializationInput.myCircles.push_back(circle);
+				if (i % 2 == 0)
+					serializationInput.myShapes.emplace_back(new Circle(circle));
+				else
+					serializationInput.myShapes.emplace_back(new Shape());
 			}
 
-			// Upcast std
-			{
-				auto before = steady_clock::now();
-
-				RunDynamicCastTest<Base4>(testObjects, loopCount);
-
-				auto after = steady_clock::now();
-				duration<double, std::milli> deltaTime = after - before;
+			serializationInput.myParticleWriters.emplace_back(new MemberWriter<Particle, Particle, Vector3, &Particle::myPosition>());
+			serializationInput.myParticleWriters.emplace_back(new MemberWriter<Particle, Particle, Vector3, &Particle::myVelocity>());
+			serializationInput.myParticleWriters.emplace_back(new MemberWriter<Particle, Particle, uint32_t, &Particle::myId>());
+			serializationInput.myCircleWriters.emplace_back(new MemberWriter<Circle, Shape, Vector3, &Shape::myPosition>());
+			serializationInput.myCircleWriters.emplace_back(new MemberWriter<Circle, Shape, int, &Shape::myLayer>());
+			serializationInput.myCircleWriters.emplace_back(new MemberWriter<Circle, Circle, float, &Circle::myRadius>());
+
+			// Writes are measured once the buffer has grown
+			serializationInput.myWriter.Reserve(iterations * sizeof(Particle) * 2);
+			for (const Circle& circle : serializationInput.myCircles)
+				serializationInput.myCircleData.Write(circle);
+			return serializationInput;
+		});
+
+		auto getWriteThroughput = [](SerializationInput& anInput, double aMedianTime) {
+			char note[64];
+			snprintf(note, sizeof(note), "%.2f GB/s", anInput.myWriter.GetSize() / (aMedianTime * 1e6));
+			return string(note);
+		};
+
+		runner.AddCase(
+			"Serialization/Particles Virtual per field", input,
+			[](SerializationInput& anInput) {
+				return RunVirtualFieldWriterTest(anInput.myParticles, anInput.myParticleWriters, anInput.myWriter);
+			},
+			getWriteThroughput);
+		runner.AddCase(
+			"Serialization/Particles KCL WriteArray", input,
+			[](SerializationInput& anInput) {
+				anInput.myWriter.Clear();
+				anInput.myWriter.WriteArray(anInput.myParticles.data(), anInput.myParticles.size());
+				return anInput.myParticles.size();
+			},
+			getWriteThroughput);
+		runner.AddCase(
+			"Serialization/Circles Virtual per field", input,
+			[](SerializationInput& anInput) {
+				return RunVirtualFieldWriterTest(anInput.myCircles, anInput.myCircleWriters, anInput.myWriter);
+			},
+			getWriteThroughput);
+		runner.AddCase(
+			"Serialization/Circles KCL Write", input,
+			[](SerializationInput& anInput) {
+				anInput.myWriter.Clear();
+				for (const Circle& circle : anInput.myCircles)
+					anInput.myWriter.Write(circle);
+				return anInput.myCircles.size();
+			},
+			getWriteThroughput);
+		runner.AddCase(
+			"Serialization/Shapes KCL WritePolymorphic", input,
+			[](SerializationInput& anInput) {
+				anInput.myWriter.Clear();
+				for (const auto& shape : anInput.myShapes)
+					anInput.myWriter.WritePolymorphic(shape.get());
+				return anInput.myShapes.size();
+			},
+			getWriteThroughput);
+		runner.AddCase(
+			"Serialization/Circles KCL Read", input,
+			[](SerializationInput& anInput) {
+				BinaryReader reader(anInput.myCircleData.GetData(), anInput.myCircleData.GetSize());
+				for (Circle& circle : anInput.myCircles)
+					reader.Read(circle);
+				resultCounter += reader.IsValid();
+				return anInput.myCircles.size();
+			},
+			[](SerializationInput& anInput, double aMedianTime) {
+				char note[64];
+				snprintf(note, sizeof(note), "%.2f GB/s", anInput.myCircleData.GetSize() / (aMedianTime * 1e6));
+				return string(note);
+			});
+	}
 
-				printf("Nested Multiple Inheritance 3*2 STD Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-					deltaTime.count() / (float)loopCount);
+	// Spawning of objects by type id, 50000 a frame
+	{
+		struct SpawnInput
+		{
+			vector<typeId_t> myTypeIds;
+			unique_ptr<ObjectFactory> myFactory;
+			vector<Base1*> myObjects;
+			vector<shared_ptr<Base1>> mySharedObjects;
+		};
+
+		static const size_t theSpawnCountPerFrame = 50000;
+		auto input = runner.AddFixture([]() {
+			SpawnInput spawnInput;
+			const typeId_t typeIds[] = {GetTypeId<Derived1A>(), GetTypeId<Derived3B>(), GetTypeId<Multi1A>()};
+			mt19937 random(42);
+			for (size_t i = 0; i < theSpawnCountPerFrame; i++)
+				spawnInput.myTypeIds.push_back(typeIds[random() % 3]);
+			spawnInput.myFactory.reset(new ObjectFactory());
+			spawnInput.myObjects.reserve(theSpawnCountPerFrame);
+			spawnInput.mySharedObjects.reserve(theSpawnCountPerFrame);
+			return spawnInput;
+		});
+
+		// The objects of a frame are all destroyed before the next one
+		static const int theFrameCount = 10;
+		runner.AddCase("Spawning/make_shared", input, [](SpawnInput& anInput) {
+			for (int frame = 0; frame < theFrameCount; frame++)
+			{
+				for (typeId_t typeId : anInput.myTypeIds)
+				{
+					if (typeId == GetTypeId<Derived1A>())
+						anInput.mySharedObjects.push_back(make_shared<Derived1A>());
+					else if (typeId == GetTypeId<Derived3B>())
+						anInput.mySharedObjects.push_back(make_shared<Derived3B>());
+					else
+						anInput.mySharedObjects.push_back(make_shared<Multi1A>());
+				}
+				resultCounter += anInput.mySharedObjects.back()->KCL_RTTI_GetTypeId();
+				anInput.mySharedObjects.clear();
 			}
+			return theFrameCount * anInput.myTypeIds.size();
+		});
+		runner.AddCase(
+			"Spawning/KCL ObjectFactory", input,
+			[](SpawnInput& anInput) {
+				for (int frame = 0; frame < theFrameCount; frame++)
+				{
+					for (typeId_t typeId : anInput.myTypeIds)
+						anInput.myObjects.push_back(anInput.myFactory->Create<Base1>(typeId));
+					resultCounter += anInput.myObjects.back()->KCL_RTTI_GetTypeId();
+					for (Base1* object : anInput.myObjects)
+						anInput.myFactory->Destroy(object);
+					anInput.myObjects.clear();
+				}
+				return theFrameCount * anInput.myTypeIds.size();
+			},
+			[](SpawnInput& anInput, double) {
+				size_t highWaterMark = 0;
+				size_t byteSize = 0;
+				anInput.myFactory->ForEachPool([&](const TypePool& aPool) {
+					highWaterMark += aPool.GetHighWaterMark();
+					byteSize += aPool.GetByteSize();
+				});
+				return "high-water mark: " + to_string(highWaterMark) + ", pools: " + to_string(byteSize / 1024) + " KB";
+			});
+	}
 
-			// Upcast kcl
+	// Loading of a block of objects, patching the vtable pointers in place against allocating each object
+	{
+		struct ArchiveInput
+		{
+			vector<uint8_t> myArchiveData;
+			// Copy of the archive data, stands for the mapped file
+			vector<uint8_t> myLoadedData;
+			unique_ptr<ObjectArchive> myArchive;
+			BinaryWriter myStream;
+		};
+
+		auto input = runner.AddFixture([]() {
+			ArchiveInput archiveInput;
+			ArchiveWriter archiveWriter;
+			for (int i = 0; i < iterations; i++)
 			{
-				auto before = steady_clock::now();
-
-				RunKCLCastTest<Base4>(testObjects, loopCount);
-
-				auto after = steady_clock::now();
-				duration<double, std::milli> deltaTime = after - before;
-
-				printf("Nested Multiple Inheritance 3*2 KCL Upcast i: %zu, time (ms): %f\n", testObjects.size(),
-					deltaTime.count() / (float)loopCount);
+				Circle circle;
+				circle.myRadius = (float)i;
+				archiveWriter.Add(&circle);
+				archiveInput.myStream.WritePolymorphic(&circle);
 			}
+			archiveWriter.Write(archiveInput.myArchiveData);
+			archiveInput.myLoadedData.resize(archiveInput.myArchiveData.size());
+			archiveInput.myArchive.reset(new ObjectArchive());
+			return archiveInput;
+		});
+
+		runner.AddCase("Archive load/KCL ObjectArchive", input, [](ArchiveInput& anInput) {
+			memcpy(anInput.myLoadedData.data(), anInput.myArchiveData.data(), anInput.myArchiveData.size());
+			anInput.myArchive->LoadFromMemory(anInput.myLoadedData.data(), anInput.myLoadedData.size());
+			resultCounter += anInput.myArchive->Get<Circle>(anInput.myArchive->GetObjectCount() - 1)->KCL_RTTI_GetTypeId();
+			return anInput.myArchive->GetObjectCount();
+		});
+		runner.AddCase("Archive load/KCL ReadPolymorphic", input, [](ArchiveInput& anInput) {
+			vector<unique_ptr<Circle>> circles;
+			circles.reserve(iterations);
+			BinaryReader reader(anInput.myStream.GetData(), anInput.myStream.GetSize());
+			while (reader.GetRemainingSize() > 0)
+				circles.emplace_back(reader.ReadPolymorphic<Circle>());
+			resultCounter += circles.back()->KCL_RTTI_GetTypeId();
+			return circles.size();
+		});
+	}
 
-			// Downcast std
+	// Throughput of the casts on several threads, each thread casts as many objects as the single threaded case.
+	// Shared: all the threads read the same objects and type data. Per-thread: each thread has its own objects.
+	// Efficiency is the single threaded median over the median on n threads, 100% when the casts scale linearly.
+	// Note: with --cpu=N the thread i runs on the core N + i.
+	{
+		struct ScalingInput
+		{
+			TestObjects<Base1> mySharedObjects;
+			vector<TestObjects<Base1>> myThreadObjects;
+			unique_ptr<BenchmarkThreadPool> myThreadPool;
+			vector<ThreadCounter> myCounters;
+			// Median of the single threaded case, by implementation and object set
+			unordered_map<string, double> mySingleThreadTimes;
+		};
+
+		// Smaller sets than the other cases, there is one per thread
+		static const size_t theObjectCountPerType = iterations / 4;
+		const size_t maxThreadCount = max(someOptions.myThreadCount, 1);
+
+		const int firstCpu = someOptions.myCpu;
+		auto input = runner.AddFixture([maxThreadCount, firstCpu]() {
+			ScalingInput scalingInput;
+			scalingInput.mySharedObjects =
+				MakeTestObjects<Base1, Derived7A, Derived7B, Derived7C>(ObjectLayout::Heap, theObjectCountPerType);
+			for (size_t i = 0; i < maxThreadCount; i++)
 			{
-				auto before = steady_clock::now();
-
-				RunDynamicCastTest<Multi4C>(testObjects, loopCount);
-
-				auto after = steady_clock::now();
-				duration<double, std::milli> deltaTime = after - before;
-
-				printf("Nested Multiple Inheritance 3*2 STD Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-					deltaTime.count() / (float)loopCount);
+				scalingInput.myThreadObjects.push_back(
+					MakeTestObjects<Base1, Derived7A, Derived7B, Derived7C>(ObjectLayout::Heap, theObjectCountPerType));
 			}
-
-			// Downcast kcl
+			scalingInput.myThreadPool.reset(new BenchmarkThreadPool(maxThreadCount, firstCpu));
+			scalingInput.myCounters.resize(maxThreadCount);
+			return scalingInput;
+		});
+
+		vector<size_t> threadCounts;
+		for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+			threadCounts.push_back(threadCount);
+		threadCounts.push_back(maxThreadCount);
+
+		typedef void (*ThreadTest)(const TestObjects<Base1>&, ThreadCounter&);
+		auto addScalingCases = [&](const string& anImplementation, ThreadTest aTest) {
+			for (bool isShared : {true, false})
 			{
-				auto before = steady_clock::now();
+				const string key = anImplementation + (isShared ? " Downcast Shared" : " Downcast Per-thread");
+				for (size_t threadCount : threadCounts)
+				{
+					runner.AddCase(
+						"Scaling/" + key + " " + to_string(threadCount) + (threadCount == 1 ? " thread" : " threads"), input,
+						[aTest, isShared, threadCount](ScalingInput& anInput) {
+							anInput.myThreadPool->Run(threadCount, [&anInput, aTest, isShared](size_t aThreadIndex) {
+								aTest(isShared ? anInput.mySharedObjects : anInput.myThreadObjects[aThreadIndex],
+									  anInput.myCounters[aThreadIndex]);
+							});
+							for (ThreadCounter& counter : anInput.myCounters)
+							{
+								resultCounter += counter.myValue;
+								counter.myValue = 0;
+							}
+							return threadCount * anInput.mySharedObjects.size();
+						},
+						[key, threadCount](ScalingInput& anInput, double aMedianTime) {
+							// Cases run in order, the single threaded case of the same key ran first
+							if (threadCount == 1)
+								anInput.mySingleThreadTimes[key] = aMedianTime;
+
+							char note[128];
+							const double threadThroughput = anInput.mySharedObjects.size() / (aMedianTime * 1000.0);
+							auto singleThreadTime = anInput.mySingleThreadTimes.find(key);
+							if (singleThreadTime != anInput.mySingleThreadTimes.end())
+							{
+								snprintf(note, sizeof(note), "%.1f Mitems/s per thread, efficiency %.0f%%", threadThroughput,
+										 100.0 * singleThreadTime->second / aMedianTime);
+							}
+							else
+								snprintf(note, sizeof(note), "%.1f Mitems/s per thread", threadThroughput);
+							return string(note);
+						});
+				}
+			}
+		};
 
-				RunKCLCastTest<Multi4C>(testObjects, loopCount);
+		addScalingCases("STD", RunDynamicCastThreadTest<Derived7A, Base1>);
+		addScalingCases("KCL", RunKCLCastThreadTest<Derived7A, Base1>);
+		addScalingCases("KCL Cached", RunKCLCachedCastThreadTest<Derived7A, Base1>);
+	}
 
-				auto after = steady_clock::now();
-				duration<double, std::milli> deltaTime = after - before;
+	const int regressionCount = runner.Run(someOptions);
 
-				printf("Nested Multiple Inheritance 3*2 KCL Downcast i: %zu, time (ms): %f\n", testObjects.size(),
-					deltaTime.count() / (float)loopCount);
-			}
-		}
-	}
+#if KCL_RTTI_PROFILE
+	PrintCastProfile(stderr, 20);
+#endif
 
-	printf("Valid cast counter: %d", validCastCounter);
+	// Printed apart from the report so that the results are used and the loops are not optimized away
+	fprintf(stderr, "Valid cast counter: %d, result counter: %zu\n", validCastCounter, resultCounter);
+	fprintf(stderr, "Type data: %zu types, %zu bytes\n", TypeRegistry::GetInstance().GetTypeCount(),
+			TypeRegistry::GetInstance().GetTotalTypeDataByteSize());
+	return regressionCount;
 }
 } // namespace KCL_Test
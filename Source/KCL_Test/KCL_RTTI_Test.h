@@ -24,6 +24,9 @@
 
 namespace KCL_Test
 {
+struct BenchmarkOptions;
+
 void RTTI_Test();
-void RTTI_Benchmark();
+// Returns the number of regressions against the baseline
+int RTTI_Benchmark(const BenchmarkOptions& someOptions);
 } // namespace KCL_Test
@@ -20,12 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "KCL_Benchmark.h"
 #include "KCL_RTTI_Test.h"
 #include <cstdio>
 
 int main(int argc, char* argv[])
 {
+	KCL_Test::BenchmarkOptions options;
+	if (!KCL_Test::ParseBenchmarkOptions(argc, argv, options))
+		return 1;
+
 	KCL_Test::RTTI_Test();
-	KCL_Test::RTTI_Benchmark();
-	return 0;
+	return KCL_Test::RTTI_Benchmark(options) > 0 ? 1 : 0;
 }